@@ -0,0 +1,355 @@
+#include "async_reader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define ASYNC_READER_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ io_uring backend ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+#ifdef ASYNC_READER_HAS_IO_URING
+
+// The rings are shared with the kernel, so their indices are accessed with acquire/release ordering
+struct AsyncReader::IoUring
+{
+    int ringFd = -1;
+    void *sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void *cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    ~IoUring()
+    {
+        if (sqes != MAP_FAILED)
+        {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+        {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED)
+        {
+            munmap(sqRing, sqRingSize);
+        }
+        if (ringFd != -1)
+        {
+            close(ringFd);
+        }
+    }
+};
+
+bool AsyncReader::setupIoUring()
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int ringFd = syscall(__NR_io_uring_setup, queueDepth, &params);
+    if (ringFd == -1)
+    {
+        return false; // Not supported by this kernel or blocked, use the thread pool instead
+    }
+
+    std::unique_ptr<IoUring> newRing = std::make_unique<IoUring>();
+    newRing->ringFd = ringFd;
+    newRing->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    newRing->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap)
+    {
+        newRing->sqRingSize = newRing->cqRingSize = std::max(newRing->sqRingSize, newRing->cqRingSize);
+    }
+
+    newRing->sqRing = mmap(nullptr, newRing->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (newRing->sqRing == MAP_FAILED)
+    {
+        return false;
+    }
+    newRing->cqRing = singleMap ? newRing->sqRing
+                                : mmap(nullptr, newRing->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (newRing->cqRing == MAP_FAILED)
+    {
+        return false;
+    }
+    newRing->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    newRing->sqes = static_cast<io_uring_sqe *>(mmap(nullptr, newRing->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+    if (newRing->sqes == MAP_FAILED)
+    {
+        return false;
+    }
+
+    uint8_t *sqRing = static_cast<uint8_t *>(newRing->sqRing);
+    uint8_t *cqRing = static_cast<uint8_t *>(newRing->cqRing);
+    newRing->sqTail = reinterpret_cast<unsigned *>(sqRing + params.sq_off.tail);
+    newRing->sqMask = reinterpret_cast<unsigned *>(sqRing + params.sq_off.ring_mask);
+    newRing->sqArray = reinterpret_cast<unsigned *>(sqRing + params.sq_off.array);
+    newRing->cqHead = reinterpret_cast<unsigned *>(cqRing + params.cq_off.head);
+    newRing->cqTail = reinterpret_cast<unsigned *>(cqRing + params.cq_off.tail);
+    newRing->cqMask = reinterpret_cast<unsigned *>(cqRing + params.cq_off.ring_mask);
+    newRing->cqes = reinterpret_cast<io_uring_cqe *>(cqRing + params.cq_off.cqes);
+
+    queueDepth = std::min<int>(queueDepth, params.sq_entries);
+    ring = std::move(newRing);
+    return true;
+}
+
+void AsyncReader::readBatchIoUring(const std::vector<ReadRequest> &requests, const std::function<void(int, bool)> &onComplete)
+{
+    std::vector<iovec> iovecs(requests.size());
+    size_t numSubmitted = 0;
+    size_t numCompleted = 0;
+    std::exception_ptr callbackError;
+
+    while (numCompleted < requests.size())
+    {
+        // Fill the submission queue up to the queue depth
+        unsigned toSubmit = 0;
+        unsigned sqTail = *ring->sqTail;
+        while (numSubmitted - numCompleted < (size_t)queueDepth && numSubmitted < requests.size())
+        {
+            const ReadRequest &request = requests[numSubmitted];
+            iovecs[numSubmitted].iov_base = request.buffer;
+            iovecs[numSubmitted].iov_len = request.length;
+
+            unsigned index = sqTail & *ring->sqMask;
+            io_uring_sqe *sqe = &ring->sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = fd;
+            sqe->off = request.offset;
+            sqe->addr = reinterpret_cast<uint64_t>(&iovecs[numSubmitted]);
+            sqe->len = 1;
+            sqe->user_data = numSubmitted;
+            ring->sqArray[index] = index;
+            sqTail++;
+            toSubmit++;
+            numSubmitted++;
+        }
+        __atomic_store_n(ring->sqTail, sqTail, __ATOMIC_RELEASE);
+
+        // Submit and wait for at least one completion
+        while (syscall(__NR_io_uring_enter, ring->ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) == -1)
+        {
+            if (errno != EINTR)
+            {
+                throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+            }
+            toSubmit = 0; // The submissions were consumed before the interrupted wait
+        }
+
+        unsigned cqHead = *ring->cqHead;
+        while (cqHead != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        {
+            const io_uring_cqe &cqe = ring->cqes[cqHead & *ring->cqMask];
+            int requestIndex = cqe.user_data;
+            bool success = cqe.res == (int)requests[requestIndex].length;
+            cqHead++;
+            __atomic_store_n(ring->cqHead, cqHead, __ATOMIC_RELEASE);
+            numCompleted++;
+            if (!callbackError)
+            {
+                try
+                {
+                    onComplete(requestIndex, success);
+                }
+                catch (...)
+                {
+                    callbackError = std::current_exception();
+                }
+            }
+        }
+    }
+
+    if (callbackError)
+    {
+        std::rethrow_exception(callbackError);
+    }
+}
+
+#else
+
+struct AsyncReader::IoUring
+{
+};
+
+bool AsyncReader::setupIoUring()
+{
+    return false;
+}
+
+void AsyncReader::readBatchIoUring(const std::vector<ReadRequest> &requests, const std::function<void(int, bool)> &onComplete)
+{
+    readBatchThreadPool(requests, onComplete);
+}
+
+#endif
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ pread thread pool backend ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+/**
+ * @brief Read every byte of the request, retrying short reads. Returns false on an error or at end of file.
+ */
+static bool readFully(int fd, const ReadRequest &request)
+{
+    char *buffer = static_cast<char *>(request.buffer);
+    size_t remaining = request.length;
+    off_t offset = request.offset;
+    while (remaining > 0)
+    {
+        ssize_t bytesRead = pread(fd, buffer, remaining, offset);
+        if (bytesRead == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesRead <= 0)
+        {
+            return false;
+        }
+        buffer += bytesRead;
+        offset += bytesRead;
+        remaining -= bytesRead;
+    }
+    return true;
+}
+
+void AsyncReader::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        workAvailable.wait(lock, [this]
+                           { return stopping || (currentBatch != nullptr && nextRequest < currentBatch->size()); });
+        if (stopping)
+        {
+            return;
+        }
+        int requestIndex = nextRequest++;
+        const ReadRequest &request = (*currentBatch)[requestIndex];
+
+        lock.unlock();
+        bool success = readFully(fd, request);
+        lock.lock();
+
+        completions.emplace_back(requestIndex, success);
+        completionAvailable.notify_one();
+    }
+}
+
+void AsyncReader::readBatchThreadPool(const std::vector<ReadRequest> &requests, const std::function<void(int, bool)> &onComplete)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    currentBatch = &requests;
+    nextRequest = 0;
+    workAvailable.notify_all();
+
+    size_t numCompleted = 0;
+    std::exception_ptr callbackError;
+    while (numCompleted < requests.size())
+    {
+        completionAvailable.wait(lock, [this]
+                                 { return !completions.empty(); });
+        std::deque<std::pair<int, bool>> finished;
+        finished.swap(completions);
+
+        // Run the callbacks without the lock, so the workers can keep reading
+        lock.unlock();
+        for (auto &completion : finished)
+        {
+            numCompleted++;
+            if (!callbackError)
+            {
+                try
+                {
+                    onComplete(completion.first, completion.second);
+                }
+                catch (...)
+                {
+                    callbackError = std::current_exception();
+                }
+            }
+        }
+        lock.lock();
+    }
+    currentBatch = nullptr;
+    lock.unlock();
+
+    if (callbackError)
+    {
+        std::rethrow_exception(callbackError);
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ AsyncReader ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+AsyncReader::AsyncReader(int fd, int queueDepth)
+    : fd(fd), queueDepth(queueDepth), currentBatch(nullptr), nextRequest(0), stopping(false)
+{
+    if (queueDepth < 1)
+    {
+        throw std::invalid_argument("AsyncReader needs a queue depth of at least 1");
+    }
+    if (!setupIoUring())
+    {
+        int numWorkers = std::min(queueDepth, MAX_WORKER_THREADS);
+        for (int i = 0; i < numWorkers; i++)
+        {
+            workers.emplace_back(&AsyncReader::workerLoop, this);
+        }
+    }
+}
+
+AsyncReader::~AsyncReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void AsyncReader::readBatch(const std::vector<ReadRequest> &requests, const std::function<void(int, bool)> &onComplete)
+{
+    if (requests.empty())
+    {
+        return;
+    }
+    if (ring != nullptr)
+    {
+        readBatchIoUring(requests, onComplete);
+    }
+    else
+    {
+        readBatchThreadPool(requests, onComplete);
+    }
+}
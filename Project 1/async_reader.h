@@ -0,0 +1,81 @@
+/**
+ * @file async_reader.h
+ * @brief Defines the AsyncReader class, which reads batches of pages from a file with many requests in flight.
+ *
+ * A single pread only keeps one request in flight, so a scan over a data file pays the full device
+ * latency once per block. The AsyncReader accepts a whole batch of reads instead and keeps up to
+ * queueDepth of them outstanding at once. Reads complete out of order, and the caller is told about
+ * each one as soon as it finishes.
+ *
+ * On Linux the reads are submitted through io_uring when the kernel supports it. Otherwise, or when
+ * io_uring cannot be set up (old kernel, seccomp filter), a small pool of threads issues plain preads
+ * in parallel. In both cases the completion callback runs on the thread that called readBatch(), so
+ * callers do not need any locking of their own.
+ */
+
+#ifndef ASYNC_READER_H
+#define ASYNC_READER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+struct ReadRequest
+{
+    off_t offset;  // Byte offset in the file
+    void *buffer;  // Destination, at least length bytes
+    size_t length; // Number of bytes to read
+};
+
+class AsyncReader
+{
+private:
+    static constexpr int MAX_WORKER_THREADS = 8; // Upper bound of the pread thread pool
+
+    struct IoUring; // Ring state, only defined where io_uring is available
+
+    int fd;
+    int queueDepth; // Maximum number of reads in flight
+    std::unique_ptr<IoUring> ring;
+
+    // pread thread pool, only started when io_uring is not used
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable completionAvailable;
+    const std::vector<ReadRequest> *currentBatch; // Batch being read, nullptr when idle
+    size_t nextRequest;                           // Index of the next request of the batch to hand to a worker
+    std::deque<std::pair<int, bool>> completions; // Finished requests and whether they read every byte
+    bool stopping;
+
+    bool setupIoUring();
+    void readBatchIoUring(const std::vector<ReadRequest> &requests, const std::function<void(int, bool)> &onComplete);
+    void readBatchThreadPool(const std::vector<ReadRequest> &requests, const std::function<void(int, bool)> &onComplete);
+    void workerLoop();
+
+public:
+    AsyncReader(int fd, int queueDepth);
+    ~AsyncReader();
+
+    AsyncReader(const AsyncReader &) = delete;
+    AsyncReader &operator=(const AsyncReader &) = delete;
+
+    /**
+     * Read every request of the batch and return once all of them have finished.
+     * onComplete(index, success) is called on this thread for each request, in completion order.
+     * success is false if the read failed or returned fewer than length bytes, the caller decides how to recover.
+     * If onComplete throws, the remaining reads are still waited for before the exception is rethrown.
+     */
+    void readBatch(const std::vector<ReadRequest> &requests, const std::function<void(int, bool)> &onComplete);
+
+    bool usesIoUring() const { return ring != nullptr; };
+};
+
+#endif // ASYNC_READER_H
@@ -1,12 +1,16 @@
 #include <iostream>
 #include <stack>
 #include <cmath>
-#include <tuple>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
 #include "b_plus_tree.h"
 #include "tree_helper.h"
+#include "node_search.h"
 using namespace std;
 
-int BPTree::getTreeHeight()
+template <typename Key, typename Value, int Fanout>
+int BPTree<Key, Value, Fanout>::getTreeHeight() const
 {
     if (root == nullptr)
     {
@@ -15,143 +19,112 @@ int BPTree::getTreeHeight()
     }
     else
     {
-        // Recursively fetch one level below until leaf node is reached
-
-        int height = 1;
-        Node *cur = root;
-
-        // Check if cur is a LeafNode. If not, check downwards
-        NonLeafNode *nonLeafNode = dynamic_cast<NonLeafNode *>(cur);
-        while (nonLeafNode != nullptr)
-        {
-            cur = nonLeafNode->ptrArray[0]; // First pointer of node
-            nonLeafNode = dynamic_cast<NonLeafNode *>(cur);
-            height++;
-        }
-
-        return height;
+        // Every node records its level above the LeafNodes
+        return root->level + 1;
     }
 }
 
-vector<tuple<int, int>> BPTree::exactSearch(int key)
+template <typename Key, typename Value, int Fanout>
+vector<Value> BPTree<Key, Value, Fanout>::exactSearch(Key key) const
 {
     Node *cur = getLeafNode(key, false);
 
     // For each exact match, store the resulting pointer
-    vector<tuple<int, int>> results;
-    LeafNode *leafNode = dynamic_cast<LeafNode *>(cur);
-    bool isSearching = true; // keep track of whether the next LeafNode still needs to be searched or not
+    vector<Value> results;
+    LeafNode *leafNode = static_cast<LeafNode *>(cur);
 
     // Continue looping until reached last LeafNode or key is greater than target
-    while (isSearching || leafNode != nullptr)
+    while (leafNode != nullptr)
     {
-        // Loop through one LeafNode
-        for (KeyPointerPair kpp : leafNode->kppArray)
+        // Loop through the keys in use of one LeafNode
+        for (int i = 0; i < leafNode->numKeys; i++)
         {
+            const KeyPointerPair &kpp = leafNode->kppArray[i];
 
             // Check if exact match
             if (key == kpp.key)
             {
-                tuple<int, int> recordPtr = make_tuple(kpp.blockId, kpp.blockOffset);
-                results.push_back(recordPtr);
+                results.push_back(kpp.pointer);
             }
             else if (key < kpp.key)
             {
-
                 // The rest of the keys are greater than the target
                 // No need to search anymore
-                isSearching = false;
                 return results;
             }
-            // Otherwise, key is smaller than target, or key is empty.
+            // Otherwise, key is smaller than target.
             // Continue searching the next LeafNode
         }
 
         // Fetch next LeafNode in linked list to continue searching
-        cur = leafNode->nextNode;
-        leafNode = dynamic_cast<LeafNode *>(cur);
+        leafNode = leafNode->nextNode;
     }
 
     return results;
 }
 
-vector<tuple<int, int>> BPTree::rangeSearch(int low, int high)
+template <typename Key, typename Value, int Fanout>
+vector<Value> BPTree<Key, Value, Fanout>::rangeSearch(Key low, Key high) const
 {
     Node *cur = getLeafNode(low, false);
 
     // For each exact match, store the resulting pointer
-    vector<tuple<int, int>> results;
-    LeafNode *leafNode = dynamic_cast<LeafNode *>(cur);
-    bool isSearching = true; // keep track of whether the next LeafNode still needs to be searched or not
+    vector<Value> results;
+    LeafNode *leafNode = static_cast<LeafNode *>(cur);
 
     // Continue looping until reached last LeafNode or key is greater than upper bound
-    while (isSearching || leafNode != nullptr)
+    while (leafNode != nullptr)
     {
-        // Loop through one LeafNode
-        for (KeyPointerPair kpp : leafNode->kppArray)
+        // Loop through the keys in use of one LeafNode
+        for (int i = 0; i < leafNode->numKeys; i++)
         {
+            const KeyPointerPair &kpp = leafNode->kppArray[i];
 
             // Check if within range
             if (low <= kpp.key && high >= kpp.key)
             {
-                tuple<int, int> recordPtr = make_tuple(kpp.blockId, kpp.blockOffset);
-                results.push_back(recordPtr);
+                results.push_back(kpp.pointer);
             }
             else if (high < kpp.key)
             {
-
                 // The rest of the keys are greater than the upper bound
                 // No need to search anymore
-                isSearching = false;
-                break;
+                return results;
             }
-            // Otherwise, key is smaller than upper bound, or key is empty.
+            // Otherwise, key is smaller than lower bound.
             // Continue searching the next LeafNode
         }
 
         // Fetch next LeafNode in linked list to continue searching
-        cur = leafNode->nextNode;
-        leafNode = dynamic_cast<LeafNode *>(cur);
+        leafNode = leafNode->nextNode;
     }
 
     return results;
 }
 
-int BPTree::getNumIndexNodes(int key)
+template <typename Key, typename Value, int Fanout>
+int BPTree<Key, Value, Fanout>::getNumIndexNodes(Key key) const
 {
     Node *cur = root;
     int num = 0;
 
     // Check if cur is a LeafNode. If not, check downwards
-    NonLeafNode *nonLeafNode = dynamic_cast<NonLeafNode *>(cur);
-    while (nonLeafNode != nullptr)
+    while (cur != nullptr && !cur->isLeaf())
     {
+        NonLeafNode *nonLeafNode = static_cast<NonLeafNode *>(cur);
+
         // This node is a non-leaf node, increment answer by 1
         num++;
 
         // Determine the next node to go downwards
-        int index = 0;
-        for (double i : nonLeafNode->keyArray)
-        {
-            if (key > i && i != nullInt)
-            {
-                index++;
-            }
-            else
-            {
-                break;
-            }
-        }
-        cur = nonLeafNode->ptrArray[index];
-
-        // Check while loop condition
-        nonLeafNode = dynamic_cast<NonLeafNode *>(cur);
+        cur = nonLeafNode->ptrArray[NodeSearch::lowerBound(nonLeafNode, key)];
     }
 
     return num;
 }
 
-int BPTree::getTotalNumNodes()
+template <typename Key, typename Value, int Fanout>
+int BPTree<Key, Value, Fanout>::getTotalNumNodes() const
 {
     // Use DFS to traverse through all nodes
     int numNodes = 0;
@@ -169,16 +142,14 @@ int BPTree::getTotalNumNodes()
 
         // Process the current Node
         // Check if this is a LeafNode
-        LeafNode *leafNode = dynamic_cast<LeafNode *>(cur);
-        if (leafNode != nullptr)
+        if (cur->isLeaf())
         {
             // Nothing more needs to be done, continue the while loop
             continue;
         }
 
-        // Otherwise, this should be a NonLeafNode
-        NonLeafNode *nonLeafNode = dynamic_cast<NonLeafNode *>(cur);
-        if (nonLeafNode != nullptr)
+        // Otherwise, this is a NonLeafNode
+        NonLeafNode *nonLeafNode = static_cast<NonLeafNode *>(cur);
         {
             // Add all Node pointers to the stack
             for (Node *ptr : nonLeafNode->ptrArray)
@@ -197,11 +168,11 @@ int BPTree::getTotalNumNodes()
             // int key;
             // for (int i = 0; i < n; i++) {
             //     key = nonLeafNode->keyArray[i];
-            //     if (key != nullInt) {
+            //     if (key != getEmptyKey<Key>()) {
             //         // Add all non-null keys into temporary string array
             //         keysOfNode[i] = key;
             //     } else {
-            //         keysOfNode[i] = nullInt;
+            //         keysOfNode[i] = getEmptyKey<Key>();
             //     }
             // }
 
@@ -209,7 +180,7 @@ int BPTree::getTotalNumNodes()
             // cout << "(";
             // int length = sizeof(keysOfNode)/sizeof(keysOfNode[0]);
             // for (int i = 0; i < length; i++) {
-            //     if (keysOfNode[i] != nullInt) {
+            //     if (keysOfNode[i] != getEmptyKey<Key>()) {
             //         cout << keysOfNode[i];
             //     }
 
@@ -225,42 +196,29 @@ int BPTree::getTotalNumNodes()
     return numNodes;
 }
 
-void BPTree::displayLeafNodes()
+template <typename Key, typename Value, int Fanout>
+NodeMemoryUsage BPTree<Key, Value, Fanout>::getMemoryUsage() const
 {
-    Node *cur = getLeafNode(nullInt, false); // go to leftmost LeafNode directly
+    return arena.getMemoryUsage();
+}
 
-    LeafNode *leafNode = dynamic_cast<LeafNode *>(cur);
-    do
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::displayLeafNodes() const
+{
+    LeafNode *leafNode = getFirstLeafNode(); // go to leftmost LeafNode directly
+    while (leafNode != nullptr)
     {
-        int keysOfNode[n]; // keys for this node
-
-        // Traverse through one whole Node
-        for (int i = 0; i < n; i++)
-        {
-            int key = leafNode->kppArray[i].key;
-            if (key != nullInt)
-            {
-                // Add all non-null keys into temporary string array
-                keysOfNode[i] = key;
-            }
-            else
-            {
-                keysOfNode[i] = nullInt;
-            }
-        }
-
-        // Print these keys out
+        // Print the keys in use, with empty places for the rest of the node
         cout << "(";
-        int length = sizeof(keysOfNode) / sizeof(keysOfNode[0]);
-        for (int i = 0; i < length; i++)
+        for (int i = 0; i < n; i++)
         {
-            if (keysOfNode[i] != nullInt)
+            if (i < leafNode->numKeys)
             {
-                cout << keysOfNode[i];
+                cout << leafNode->kppArray[i].key;
             }
 
             // Print a comma
-            if (i != length - 1)
+            if (i != n - 1)
             {
                 cout << ",";
             }
@@ -268,44 +226,26 @@ void BPTree::displayLeafNodes()
         cout << ") -> ";
 
         // Traverse to next LeafNode in linked list
-        cur = leafNode->nextNode;
-        leafNode = dynamic_cast<LeafNode *>(cur);
-
-    } while (cur != nullptr);
+        leafNode = leafNode->nextNode;
+    }
 }
 
-void BPTree::displayRootNode()
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::displayRootNode() const
 {
-    NonLeafNode* nonLeafNode = dynamic_cast<NonLeafNode*>(root);
-    int keysOfNode[n]; // keys for this node
+    NonLeafNode* nonLeafNode = static_cast<NonLeafNode*>(root);
 
-    // Traverse through one whole Node
-    for (int i = 0; i < n; i++)
-    {
-        int key = nonLeafNode->keyArray[i];
-        if (key != nullInt)
-        {
-            // Add all non-null keys into temporary string array
-            keysOfNode[i] = key;
-        }
-        else
-        {
-            keysOfNode[i] = nullInt;
-        }
-    }
-
-    // Print these keys out
+    // Print the keys in use, with empty places for the rest of the node
     cout << "(";
-    int length = sizeof(keysOfNode) / sizeof(keysOfNode[0]);
-    for (int i = 0; i < length; i++)
+    for (int i = 0; i < n; i++)
     {
-        if (keysOfNode[i] != nullInt)
+        if (i < nonLeafNode->numKeys)
         {
-            cout << keysOfNode[i];
+            cout << nonLeafNode->keyArray[i];
         }
 
         // Print a comma
-        if (i != length - 1)
+        if (i != n - 1)
         {
             cout << ",";
         }
@@ -313,16 +253,16 @@ void BPTree::displayRootNode()
     cout << ")";
 }
 
-void BPTree::insertKey(int key, int blockId, int blockOffset)
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::insertKey(Key key, const Value &pointer)
 {
     // If the B+ tree is empty, create a new LeafNode and insert there
     if (root == nullptr)
     {
         // Create new LeafNode
-        LeafNode *newLeafNode = new LeafNode();
-        newLeafNode->kppArray[0].key = key;
-        newLeafNode->kppArray[0].blockId = blockId;
-        newLeafNode->kppArray[0].blockOffset = blockOffset;
+        LeafNode *newLeafNode = arena.createLeafNode();
+        newLeafNode->kppArray[0] = KeyPointerPair(key, pointer);
+        newLeafNode->numKeys = 1;
 
         // Assign root to new LeafNode
         root = newLeafNode;
@@ -331,19 +271,10 @@ void BPTree::insertKey(int key, int blockId, int blockOffset)
     }
 
     // Check where to insert the key
-    LeafNode *targetNode = dynamic_cast<LeafNode *>(getLeafNode(key, true));
+    LeafNode *targetNode = static_cast<LeafNode *>(getLeafNode(key, true));
 
     // Check whether the target node is already full
-    bool isFull = true;
-    for (KeyPointerPair kpp : targetNode->kppArray)
-    {
-        // isFull will be set to false if at least one key is missing
-        if (kpp.key == nullInt)
-        {
-            isFull = false;
-            break;
-        }
-    }
+    bool isFull = targetNode->numKeys == n;
 
     if (isFull)
     {
@@ -357,7 +288,7 @@ void BPTree::insertKey(int key, int blockId, int blockOffset)
         {
             if (key < kpp.key && !isInserted)
             {
-                KeyPointerPair newKpp = KeyPointerPair(key, blockId, blockOffset);
+                KeyPointerPair newKpp = KeyPointerPair(key, pointer);
                 tempKpps[tempKppsIndex++] = newKpp;
                 isInserted = true;
             }
@@ -366,7 +297,7 @@ void BPTree::insertKey(int key, int blockId, int blockOffset)
         if (!isInserted)
         {
             // The new key is bigger than all other keys
-            KeyPointerPair newKpp = KeyPointerPair(key, blockId, blockOffset);
+            KeyPointerPair newKpp = KeyPointerPair(key, pointer);
             tempKpps[tempKppsIndex++] = newKpp;
             isInserted = true;
         }
@@ -378,30 +309,26 @@ void BPTree::insertKey(int key, int blockId, int blockOffset)
         KeyPointerPair middleKpp = tempKpps[middleIndex];
 
         // Split the LeafNode into two LeafNodes
-        LeafNode *newLeafNode = new LeafNode();
+        LeafNode *newLeafNode = arena.createLeafNode();
         int nodeIndex = 0;
         for (int i = middleIndex; i < n + 1; i++)
         {
             // Insert middle element onwards to new LeafNode
-            newLeafNode->kppArray[nodeIndex].key = tempKpps[i].key;
-            newLeafNode->kppArray[nodeIndex].blockId = tempKpps[i].blockId;
-            newLeafNode->kppArray[nodeIndex].blockOffset = tempKpps[i].blockOffset;
+            newLeafNode->kppArray[nodeIndex] = tempKpps[i];
             nodeIndex++;
         }
         for (int i = 0; i < n; i++)
         {
             // Empty the target node
-            targetNode->kppArray[i].key = nullInt;
-            targetNode->kppArray[i].blockId = nullInt;
-            targetNode->kppArray[i].blockOffset = nullInt;
+            targetNode->kppArray[i] = KeyPointerPair();
         }
         for (int i = 0; i < middleIndex; i++)
         {
             // Rewrite the elements in the target LeafNode
-            targetNode->kppArray[i].key = tempKpps[i].key;
-            targetNode->kppArray[i].blockId = tempKpps[i].blockId;
-            targetNode->kppArray[i].blockOffset = tempKpps[i].blockOffset;
+            targetNode->kppArray[i] = tempKpps[i];
         }
+        targetNode->numKeys = middleIndex;
+        newLeafNode->numKeys = n + 1 - middleIndex;
 
         // Reassign pointer of the target LeafNode and new LeafNode
         newLeafNode->nextNode = targetNode->nextNode;
@@ -415,9 +342,10 @@ void BPTree::insertKey(int key, int blockId, int blockOffset)
 
             // Find the attributes required to create a new
             // NonLeafNode instance as parent node
-            NonLeafNode *parentNode = new NonLeafNode();
+            NonLeafNode *parentNode = arena.createNonLeafNode(targetNode->level + 1);
             parentNode->ptrArray[0] = targetNode;
             parentNode->keyArray[0] = middleKpp.key;
+            parentNode->numKeys = 1;
 
             // The pointer after the key in the parent node
             // Should point to the newly created LeafNode
@@ -438,114 +366,72 @@ void BPTree::insertKey(int key, int blockId, int blockOffset)
         // Node is not yet full
         // Insert the key into the right place, and then push all other
         // KeyPointerPairs backwards
-        int targetIndex = 0;
-        for (KeyPointerPair kpp : targetNode->kppArray)
-        {
-
-            // Find the first key greater than the inserting key
-            // Or empty key
-            if (key < kpp.key || kpp.key == nullInt)
-            {
-                break;
-            }
-            targetIndex++;
-        }
+        // Find the first key greater than the inserting key
+        int targetIndex = NodeSearch::upperBound(targetNode, key);
 
         // Push all of the KeyPointerPairs back until the targetIndex
-        for (int i = n - 2; i >= targetIndex; i--)
+        for (int i = targetNode->numKeys - 1; i >= targetIndex; i--)
         {
             targetNode->kppArray[i + 1] = targetNode->kppArray[i];
         }
 
         // Insert the KeyPointerPair into the empty slot
-        targetNode->kppArray[targetIndex] = KeyPointerPair(key, blockId, blockOffset);
+        targetNode->kppArray[targetIndex] = KeyPointerPair(key, pointer);
+        targetNode->numKeys++;
     }
 }
 
-Node *BPTree::getLeafNode(int key, bool insert)
+template <typename Key, typename Value, int Fanout>
+Node *BPTree<Key, Value, Fanout>::getLeafNode(Key key, bool insert) const
 {
     Node *cur = root;
 
     // Check if cur is a LeafNode. If not, check downwards
-    NonLeafNode *nonLeafNode = dynamic_cast<NonLeafNode *>(cur);
-    while (nonLeafNode != nullptr)
+    while (cur != nullptr && !cur->isLeaf())
     {
+        NonLeafNode *nonLeafNode = static_cast<NonLeafNode *>(cur);
 
         // Determine the next node to go downwards
-        int index = 0;
-        for (double i : nonLeafNode->keyArray)
-        {
-            // If key argument is equal to current key
-            bool direction;
-            if (insert) 
-            {
-                // For insert functions, go to rightmost node
-                direction = key >= i;
-            } else {
-                // For search functions, go to leftmost node
-                direction = key > i;
-            }
-
-            if (direction && i != nullInt)
-            {
-                index++;
-            }
-            else
-            {
-                break;
-            }
-        }
+        // If key argument is equal to a key of the node:
+        // for insert functions, go to rightmost node,
+        // for search functions, go to leftmost node
+        int index = insert ? NodeSearch::upperBound(nonLeafNode, key) : NodeSearch::lowerBound(nonLeafNode, key);
         cur = nonLeafNode->ptrArray[index];
-
-        // Check while loop condition
-        nonLeafNode = dynamic_cast<NonLeafNode *>(cur);
     }
 
     return cur;
 }
 
-vector<NonLeafNode *> BPTree::getNodePath(KeyPointerPair kpp)
+template <typename Key, typename Value, int Fanout>
+vector<typename BPTree<Key, Value, Fanout>::NonLeafNode *> BPTree<Key, Value, Fanout>::getNodePath(KeyPointerPair kpp)
 {
     vector<NonLeafNode *> nodePath;
 
     // If the B+ tree has no NonLeafNode layer, return null pointer
-    NonLeafNode *nonLeafNode = dynamic_cast<NonLeafNode *>(root);
-    if (nonLeafNode == nullptr)
+    if (root == nullptr || root->isLeaf())
     {
         return nodePath;
     }
 
     // Check downwards
     Node *cur = root;
-    while (nonLeafNode != nullptr)
+    nodePath.reserve(root->level);
+    while (!cur->isLeaf())
     {
+        NonLeafNode *nonLeafNode = static_cast<NonLeafNode *>(cur);
 
         // Determine the next node to go downwards
-        int index = 0;
-        for (double i : nonLeafNode->keyArray)
-        {
-            if (kpp.key > i && i != nullInt)
-            {
-                index++;
-            }
-            else
-            {
-                break;
-            }
-        }
-        cur = nonLeafNode->ptrArray[index];
+        cur = nonLeafNode->ptrArray[NodeSearch::lowerBound(nonLeafNode, kpp.key)];
 
         // Add node to path
         nodePath.push_back(nonLeafNode);
-
-        // Check while loop condition
-        nonLeafNode = dynamic_cast<NonLeafNode *>(cur);
     }
 
     return nodePath;
 }
 
-void BPTree::insertInternalNode(int key, vector<NonLeafNode *> nodePath, Node *nextPtr)
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::insertInternalNode(Key key, vector<NonLeafNode *> nodePath, Node *nextPtr)
 {
     // Retrieve current NonLeafNode which is right above the previous
     // NonLeafNode that was being inspected
@@ -553,27 +439,18 @@ void BPTree::insertInternalNode(int key, vector<NonLeafNode *> nodePath, Node *n
     nodePath.pop_back(); // in case of future calls of this function
 
     // Check whether this node is already full
-    bool isFull = true;
-    for (int key : cur->keyArray)
-    {
-        // isFull will be set to false if at least one key is missing
-        if (key == nullInt)
-        {
-            isFull = false;
-            break;
-        }
-    }
+    bool isFull = cur->numKeys == n;
 
     if (isFull)
     {
         // If current node is full, then need to involve parent node in insertion
 
         // Create a sorted temporary list of keys
-        double tempKeys[n + 1];
+        Key tempKeys[n + 1];
         int tempKeysIndex = 0;
         int insertPtrIndex = 0;  // Track where the pointer should be inserted
         bool isInserted = false; // Check if new key is already inserted
-        for (int curKey : cur->keyArray)
+        for (Key curKey : cur->keyArray)
         {
             if (key < curKey && !isInserted)
             {
@@ -615,10 +492,10 @@ void BPTree::insertInternalNode(int key, vector<NonLeafNode *> nodePath, Node *n
         // Index is half rounded down
         // Middle element will be present in parent node
         int middleIndex = floor((n + 1) / 2);
-        int middleKey = tempKeys[middleIndex];
+        Key middleKey = tempKeys[middleIndex];
 
         // Split the NonLeafNode into two NonLeafNodes
-        NonLeafNode *newNonLeafNode = new NonLeafNode();
+        NonLeafNode *newNonLeafNode = arena.createNonLeafNode(cur->level);
         int nodeIndex = 0;
         for (int i = middleIndex + 1; i < n + 1; i++)
         {
@@ -634,7 +511,7 @@ void BPTree::insertInternalNode(int key, vector<NonLeafNode *> nodePath, Node *n
         for (int i = 0; i < n; i++)
         {
             // Empty all keys from current node
-            cur->keyArray[i] = nullInt;
+            cur->keyArray[i] = getEmptyKey<Key>();
         }
         for (int i = 0; i < n + 1; i++)
         {
@@ -651,6 +528,8 @@ void BPTree::insertInternalNode(int key, vector<NonLeafNode *> nodePath, Node *n
             // And also rewrite pointers for current node
             cur->ptrArray[i] = tempPtrs[i];
         }
+        cur->numKeys = middleIndex;
+        newNonLeafNode->numKeys = n - middleIndex;
 
         // Determine the parent of the target node
         if (nodePath.size() == 0)
@@ -659,9 +538,10 @@ void BPTree::insertInternalNode(int key, vector<NonLeafNode *> nodePath, Node *n
 
             // Find the attributes required to create a new
             // NonLeafNode instance as parent node
-            NonLeafNode *parentNode = new NonLeafNode();
+            NonLeafNode *parentNode = arena.createNonLeafNode(cur->level + 1);
             parentNode->ptrArray[0] = cur;
             parentNode->keyArray[0] = middleKey;
+            parentNode->numKeys = 1;
 
             // The pointer after the key in the parent node
             // Should point to the newly created NonLeafNode
@@ -682,26 +562,16 @@ void BPTree::insertInternalNode(int key, vector<NonLeafNode *> nodePath, Node *n
         // Node is not yet full
         // Insert the key into the right place, and then push all other
         // keys and pointers backwards
-        int targetIndex = 0;
-        for (int curKey : cur->keyArray)
-        {
-
-            // Find the first key greater than the inserting key
-            // Or empty key
-            if (key < curKey || curKey == nullInt)
-            {
-                break;
-            }
-            targetIndex++;
-        }
+        // Find the first key greater than the inserting key
+        int targetIndex = NodeSearch::upperBound(cur, key);
 
         // Push all of the pointers back until after the targetIndex
-        for (int i = n - 1; i >= targetIndex + 1; i--)
+        for (int i = cur->numKeys; i >= targetIndex + 1; i--)
         {
             cur->ptrArray[i + 1] = cur->ptrArray[i];
         }
         // Push all of the keys back until the targetIndex
-        for (int i = n - 2; i >= targetIndex; i--)
+        for (int i = cur->numKeys - 1; i >= targetIndex; i--)
         {
             cur->keyArray[i + 1] = cur->keyArray[i];
         }
@@ -709,10 +579,12 @@ void BPTree::insertInternalNode(int key, vector<NonLeafNode *> nodePath, Node *n
         // Insert the key into the empty slot
         cur->keyArray[targetIndex] = key;
         cur->ptrArray[targetIndex + 1] = nextPtr;
+        cur->numKeys++;
     }
 }
 
-void BPTree::deleteKey(int key){
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::deleteKey(Key key){
     
     cout << "Deleting " << key <<  " in tree" << endl;
  
@@ -722,7 +594,7 @@ void BPTree::deleteKey(int key){
         return;
     }
     //initially, find all matches of tree
-    vector<tuple<int, int>> matches = exactSearch(key);
+    vector<Value> matches = exactSearch(key);
     int loops = matches.size();
  
     //if no exact matches, return
@@ -746,12 +618,12 @@ void BPTree::deleteKey(int key){
         std::vector<int>pathIndexes;    //vector to store indexes of path of traversal
     
         //find possible target leaf node with key, save the path.
-        NonLeafNode* nonLeafNode = dynamic_cast<NonLeafNode*>(curNode);
+        NonLeafNode* nonLeafNode = asNonLeafNode(curNode);
         while(nonLeafNode != nullptr){
             index = 0;
-            for (double i : nonLeafNode->keyArray){
+            for (Key i : nonLeafNode->keyArray){
     
-                if (key > i && i != nullInt) {
+                if (key > i && i != getEmptyKey<Key>()) {
                     index++;
                 } 
                 else {
@@ -762,13 +634,13 @@ void BPTree::deleteKey(int key){
             path.push_back(nonLeafNode);
             pathIndexes.push_back(index);
             curNode = nonLeafNode->ptrArray[index];
-            nonLeafNode = dynamic_cast<NonLeafNode*>(curNode);
+            nonLeafNode = asNonLeafNode(curNode);
         }
         //cout << "test "  << endl;
         
  
         //targetnode is leftmost leaf node containing the key
-        LeafNode* targetNode = dynamic_cast<LeafNode*>(curNode);
+        LeafNode* targetNode = asLeafNode(curNode);
         //find the key's index in leaf node, then delete the records
         //in target node, find same keys and delete the records
         //int firstIndex = std::lower_bound(targetNode->kppArray->key.begin(), targetNode->kppArray->key.end(), key) - targetNode->kppArray->key.begin();
@@ -785,7 +657,7 @@ void BPTree::deleteKey(int key){
                 }
             }
             curNode = targetNode->nextNode;
-            targetNode = dynamic_cast<LeafNode*>(curNode);
+            targetNode = asLeafNode(curNode);
         }
  
         //cout << "first indexes " << firstIndex << endl; 
@@ -801,15 +673,13 @@ void BPTree::deleteKey(int key){
         bool deleted = false;
  
         for (int j=0 ; j< n ; j++){
-            int nodeKey = targetNode->kppArray[j].key;
+            Key nodeKey = targetNode->kppArray[j].key;
             if (nodeKey == key ){
                 deleted = true;
                 int oldNum = getNumKeys(targetNode);
  
                 //delete key
-                targetNode->kppArray[j].key = nullInt;
-                targetNode->kppArray[j].blockId = nullInt;
-                targetNode->kppArray[j].blockOffset = nullInt;
+                targetNode->kppArray[j] = KeyPointerPair();
  
                 cout << "Deleted "<< key <<" at index "<< j << "\n";
  
@@ -822,9 +692,7 @@ void BPTree::deleteKey(int key){
                     }
  
                     //clear duplicate last key 
-                    targetNode->kppArray[getNumKeys(targetNode) -1].key = nullInt;
-                    targetNode->kppArray[getNumKeys(targetNode) -1].blockId = nullInt;
-                    targetNode->kppArray[getNumKeys(targetNode) -1].blockOffset = nullInt;
+                    targetNode->kppArray[getNumKeys(targetNode) -1] = KeyPointerPair();
  
  
                 }
@@ -867,7 +735,7 @@ void BPTree::deleteKey(int key){
                             //cout << firstIndex << "\n";
  
                             Node* parent = path.back();
-                            NonLeafNode* parentNode = dynamic_cast<NonLeafNode*>(parent);
+                            NonLeafNode* parentNode = asNonLeafNode(parent);
  
                             parentNode->keyArray[firstIndex-1] = key;
  
@@ -907,7 +775,7 @@ void BPTree::deleteKey(int key){
                 if(prevIndex > 0){
                     
                     leftNode = parentNode->ptrArray[prevIndex-1]; //left now points to node left of targetnode
-                    LeafNode* left = dynamic_cast<LeafNode*>(leftNode);
+                    LeafNode* left = asLeafNode(leftNode);
                     cout << "last of left neighbor " << left->kppArray[getNumKeys(left)-1].key << endl;
                     
                     //if can borrow from left, borrow
@@ -926,9 +794,7 @@ void BPTree::deleteKey(int key){
         
                         //cout << "borrow left " << "\n";
                         //remove last element of left node, doesnt reduce container size
-                        left->kppArray[getNumKeys(left) - 1].key = nullInt;
-                        left->kppArray[getNumKeys(left) - 1].blockId = nullInt;
-                        left->kppArray[getNumKeys(left) - 1].blockOffset = nullInt;                
+                        left->kppArray[getNumKeys(left) - 1] = KeyPointerPair();                
  
                         //update key in parent node to new left node added in target node
                         parentNode->keyArray[prevIndex] = targetNode->kppArray[0].key;
@@ -941,7 +807,7 @@ void BPTree::deleteKey(int key){
                 if(prevIndex < getNumKeysNL(parentNode) -1 && borrowed == 0){
                     cout << "right neighbor exists " << "\n";
                     rightNode = parentNode->ptrArray[prevIndex+1];
-                    LeafNode* right = dynamic_cast<LeafNode*>(rightNode);
+                    LeafNode* right = asLeafNode(rightNode);
                     //cout << "first of right neighbor" << right->kppArray[0].key << endl;
  
                     //if can borrow from right,borrow
@@ -960,9 +826,7 @@ void BPTree::deleteKey(int key){
  
  
                         //clear duplicate last key 
-                        right->kppArray[getNumKeys(right)-1].key = nullInt;
-                        right->kppArray[getNumKeys(right)-1].blockId = nullInt;
-                        right->kppArray[getNumKeys(right)-1].blockOffset = nullInt;
+                        right->kppArray[getNumKeys(right)-1] = KeyPointerPair();
  
                         //test
                         //cout <<  right->kppArray[0].key << endl;
@@ -997,7 +861,7 @@ void BPTree::deleteKey(int key){
  
                     cout << "merge left " << "\n";
                     merged = 1;
-                    LeafNode*left = dynamic_cast<LeafNode*>(leftNode);
+                    LeafNode*left = asLeafNode(leftNode);
                     //while no. of keys not equal to 0, put all keys from target node and merge into the left
                     while (getNumKeys(targetNode) != 0){
                         //add to last element of left node the first element of target node
@@ -1009,15 +873,16 @@ void BPTree::deleteKey(int key){
                         }
         
                         //remove duplicate key ptr in targetnode at last index
-                        targetNode->kppArray[getNumKeys(targetNode)].key = nullInt;
-                        targetNode->kppArray[getNumKeys(targetNode)].blockId = nullInt;
-                        targetNode->kppArray[getNumKeys(targetNode)].blockOffset = nullInt;
+                        targetNode->kppArray[getNumKeys(targetNode)] = KeyPointerPair();
                     }
                     //update pointer to next node
                     left->nextNode = targetNode->nextNode;
  
                     //remove internal
                     removeInternalNode(parentNode->keyArray[prevIndex-1], parentNode,targetNode);
+
+                    //target node is empty now, reuse its memory
+                    arena.releaseNode(targetNode);
                 }
         
         
@@ -1026,7 +891,7 @@ void BPTree::deleteKey(int key){
  
                     cout << "merge right " << "\n";
                     merged = 1;
-                    LeafNode* right = dynamic_cast<LeafNode*>(rightNode);
+                    LeafNode* right = asLeafNode(rightNode);
         
                     while(getNumKeys(right) != 0){
         
@@ -1039,9 +904,7 @@ void BPTree::deleteKey(int key){
                         }
  
                         //remove duplicate key ptr in rightnode at last index
-                        right->kppArray[getNumKeys(right)].key = nullInt;
-                        right->kppArray[getNumKeys(right)].blockId = nullInt;
-                        right->kppArray[getNumKeys(right)].blockOffset = nullInt;
+                        right->kppArray[getNumKeys(right)] = KeyPointerPair();
  
         
                     }
@@ -1062,6 +925,9 @@ void BPTree::deleteKey(int key){
                     targetNode->nextNode = right->nextNode;
                     //cout << prevIndex << "\n";
                     removeInternalNode(parentNode->keyArray[prevIndex],parentNode, right);
+
+                    //right node is empty now, reuse its memory
+                    arena.releaseNode(right);
                 }                   
                         
             }
@@ -1074,20 +940,22 @@ void BPTree::deleteKey(int key){
 }
 
 //get num keys in leaf node
-int BPTree::getNumKeys(LeafNode* node){
+template <typename Key, typename Value, int Fanout>
+int BPTree<Key, Value, Fanout>::getNumKeys(LeafNode* node){
     int count = 0;
     for (int i=0; i< n; i++){
-        if(node->kppArray[i].key != nullInt){
+        if(node->kppArray[i].key != getEmptyKey<Key>()){
             count++;
         }
     }
     return count;
 }
 
-int BPTree::getNumKeysNL(NonLeafNode* node){
+template <typename Key, typename Value, int Fanout>
+int BPTree<Key, Value, Fanout>::getNumKeysNL(NonLeafNode* node){
     int count = 0;
     for (int i =0;i < n;i++){
-        if(node->keyArray[i] != nullInt){
+        if(node->keyArray[i] != getEmptyKey<Key>()){
             count ++;
         }
     }
@@ -1095,7 +963,8 @@ int BPTree::getNumKeysNL(NonLeafNode* node){
 }
 
 // remove internal nodes in tree.
-void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::removeInternalNode(Key key,NonLeafNode *parent,Node *child){
     //child node is node to be deleted
     //cout << "remove internal key:" << key << endl;
     //if parent node is root
@@ -1112,6 +981,8 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
                 root = parent->ptrArray[0];
  
             }
+            //old root is no longer in the tree, reuse its memory
+            arena.releaseNode(parent);
             return;
         }
     }
@@ -1133,7 +1004,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
     }
 
     //cout <<"DELETE "<<parent->keyArray[keyindex]<<"at index"<< keyindex << endl;
-    parent->keyArray[keyindex] = nullInt;
+    parent->keyArray[keyindex] = getEmptyKey<Key>();
     //shift keys of parent 1 to the left
 
     for (int i = keyindex; i < getNumKeysNL(parent)-1 ; i++){
@@ -1141,7 +1012,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
     }
 
     //delete duplicate key at last index of parent key array
-    parent->keyArray[getNumKeysNL(parent)-1] = nullInt;
+    parent->keyArray[getNumKeysNL(parent)-1] = getEmptyKey<Key>();
     //cout <<"parent size "<< getNumKeysNL(parent) << endl;
 
     //cout << parent->keyArray[0] << endl;
@@ -1184,7 +1055,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
     Node *ancestor;
     ancestor = findParent(root,parent);
 
-    NonLeafNode* ancestorNode = dynamic_cast<NonLeafNode*>(ancestor);
+    NonLeafNode* ancestorNode = asNonLeafNode(ancestor);
 
     //index is index of pointer, from range 0 to numkeys + 1
     int index;
@@ -1196,7 +1067,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
 
     if( index > 0){
         leftParent = parent->ptrArray[index - 1];
-        NonLeafNode* leftParent = dynamic_cast<NonLeafNode*>(leftParent);
+        NonLeafNode* leftParent = asNonLeafNode(leftParent);
 
 
         //if left neighbor more than min keys
@@ -1220,7 +1091,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
 
 
             //remove last elements of left parent node, not duplicate
-            leftParent->keyArray[getNumKeysNL(leftParent)-1] = nullInt;
+            leftParent->keyArray[getNumKeysNL(leftParent)-1] = getEmptyKey<Key>();
             leftParent->ptrArray[getNumKeysNL(leftParent)] = nullptr;
             //cout << "borrowed from left neighbor of internal node" << endl;
             return;
@@ -1232,7 +1103,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
 
     if (index < getNumKeysNL(ancestorNode)+1){
         rightParent = parent->ptrArray[index+1];
-        NonLeafNode* rightParent = dynamic_cast<NonLeafNode*>(rightParent);
+        NonLeafNode* rightParent = asNonLeafNode(rightParent);
 
         //if right  more than min keys
         if(getNumKeysNL(rightParent) > (n+1)/2){
@@ -1254,7 +1125,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
             
 
             //remove duplicate key ptr of rightnode last index
-            rightParent->keyArray[getNumKeysNL(rightParent)] = nullInt;
+            rightParent->keyArray[getNumKeysNL(rightParent)] = getEmptyKey<Key>();
             rightParent->ptrArray[getNumKeysNL(rightParent)+1] = nullptr;
             //cout << "borrowed from right neighbor of internal node" << endl;
             return;
@@ -1268,7 +1139,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
     if (index > 0){
         //cout << "merge left internal node" << endl;
         leftParent = parent->ptrArray[index - 1];
-        NonLeafNode* leftParent = dynamic_cast<NonLeafNode*>(leftParent);
+        NonLeafNode* leftParent = asNonLeafNode(leftParent);
 
         //add key of ancestor to left neighbor, test if needed
         leftParent->keyArray[getNumKeysNL(leftParent)] = ancestorNode->keyArray[index - 1];
@@ -1288,7 +1159,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
             }
 
             //remove duplicate key ptr in parent at last index
-            parent->keyArray[getNumKeysNL(parent)] = nullInt;
+            parent->keyArray[getNumKeysNL(parent)] = getEmptyKey<Key>();
             parent->ptrArray[getNumKeysNL(parent)+1] = nullptr;
         }
         removeInternalNode(ancestorNode->keyArray[index - 1],ancestorNode,parent);
@@ -1299,7 +1170,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
     else  if (index < getNumKeysNL(ancestorNode)+1) {
         //cout << "merge right internal node" << endl;
         rightParent = parent->ptrArray[index+1];
-        NonLeafNode* rightParent = dynamic_cast<NonLeafNode*>(rightParent);
+        NonLeafNode* rightParent = asNonLeafNode(rightParent);
 
         parent->keyArray[getNumKeysNL(parent)] = ancestorNode->keyArray[index];
         while (getNumKeysNL(rightParent) != 0){
@@ -1319,7 +1190,7 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
             }
 
             //remove duplicate key ptr in right at last index
-            rightParent->keyArray[getNumKeysNL(rightParent)] = nullInt;
+            rightParent->keyArray[getNumKeysNL(rightParent)] = getEmptyKey<Key>();
             rightParent->ptrArray[getNumKeysNL(rightParent)+1] = nullptr;
 
         }
@@ -1329,7 +1200,8 @@ void BPTree::removeInternalNode(int key,NonLeafNode *parent,Node *child){
 }
  
 // update parent node key with key of child node
-void BPTree::updateParentKey(int prevIndex,Node *parent,Node *child,std::vector<NonLeafNode*> &path, std::vector<int> &pathIndexes){
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::updateParentKey(int prevIndex,Node *parent,Node *child,std::vector<NonLeafNode*> &path, std::vector<int> &pathIndexes){
     
     while(path.back() != nullptr){
         //if prev index = 0 (deleted key is leftmost),move up the tree till not = 0
@@ -1341,8 +1213,8 @@ void BPTree::updateParentKey(int prevIndex,Node *parent,Node *child,std::vector<
         else{
             //update parent node key
             Node* parent = path.back();
-            NonLeafNode* parentNode = dynamic_cast<NonLeafNode*>(parent);
-            LeafNode* child = dynamic_cast<LeafNode*>(child);
+            NonLeafNode* parentNode = asNonLeafNode(parent);
+            LeafNode* child = asLeafNode(child);
             int p = pathIndexes.back();
             parentNode->keyArray[p-1] = child->kppArray[0].key;
             break;
@@ -1352,9 +1224,10 @@ void BPTree::updateParentKey(int prevIndex,Node *parent,Node *child,std::vector<
 }
 
 //find parent node of node
-Node* BPTree::findParent(Node *current, Node *child){
+template <typename Key, typename Value, int Fanout>
+Node* BPTree<Key, Value, Fanout>::findParent(Node *current, Node *child){
     Node *parent;
-    NonLeafNode* currentNode = dynamic_cast<NonLeafNode*>(current);
+    NonLeafNode* currentNode = asNonLeafNode(current);
     //travel to leaf node and get key of first index
     
     if (currentNode != nullptr || currentNode->ptrArray[0] == nullptr){
@@ -1381,3 +1254,242 @@ Node* BPTree::findParent(Node *current, Node *child){
     return parent;
 
 }
+
+template <typename Key, typename Value, int Fanout>
+int BPTree<Key, Value, Fanout>::updateRecordPointers(const vector<PointerMove<Key, Value>> &moves)
+{
+    // Resolve the moves to one per record, keyed by the pointer the KeyPointerPair holds now.
+    // A record that moved twice in the batch ends up where its second move put it
+    unordered_map<Value, PointerMove<Key, Value>> movesByOrigin;
+    unordered_map<Value, Value> originOfPointer; // Current pointer of a moved record -> its pointer before the batch
+    for (const PointerMove<Key, Value> &move : moves)
+    {
+        Value origin = move.oldPointer;
+        auto arrival = originOfPointer.find(move.oldPointer);
+        if (arrival != originOfPointer.end())
+        {
+            origin = arrival->second;
+            originOfPointer.erase(arrival);
+            movesByOrigin[origin].newPointer = move.newPointer;
+        }
+        else
+        {
+            movesByOrigin[origin] = move;
+        }
+        originOfPointer[move.newPointer] = origin;
+    }
+    if (movesByOrigin.empty() || root == nullptr)
+    {
+        return 0;
+    }
+
+    // Rewrite the moved pointers in one pass over the leaves
+    int numUpdated = 0;
+    for (LeafNode *leafNode = getFirstLeafNode(); leafNode != nullptr; leafNode = leafNode->nextNode)
+    {
+        for (int i = 0; i < leafNode->numKeys; i++)
+        {
+            KeyPointerPair &kpp = leafNode->kppArray[i];
+            auto move = movesByOrigin.find(kpp.pointer);
+            if (move != movesByOrigin.end() && move->second.key == kpp.key)
+            {
+                kpp.pointer = move->second.newPointer;
+                numUpdated++;
+            }
+        }
+    }
+    return numUpdated;
+}
+
+template <typename Key, typename Value, int Fanout>
+typename BPTree<Key, Value, Fanout>::LeafNode *BPTree<Key, Value, Fanout>::getFirstLeafNode() const
+{
+    Node *cur = root;
+    while (cur != nullptr && !cur->isLeaf())
+    {
+        cur = static_cast<NonLeafNode *>(cur)->ptrArray[0];
+    }
+    return static_cast<LeafNode *>(cur);
+}
+
+/**
+ * Take the KeyPointerPairs listed in pending out of the leaf, keeping the others in order with the
+ * empty keys at the end. Removed pairs are erased from pending, and counted in remainingPerKey.
+ */
+template <typename Key, typename Value, int Fanout>
+static int removeFromLeaf(LeafNode<Key, Value, Fanout> *leafNode, unordered_map<Value, Key> &pending, unordered_map<Key, int> &remainingPerKey)
+{
+    int numKept = 0;
+    int numRemoved = 0;
+    for (int i = 0; i < leafNode->numKeys; i++)
+    {
+        KeyPointerPair<Key, Value> kpp = leafNode->kppArray[i];
+        auto entry = pending.find(kpp.pointer);
+        if (entry != pending.end() && entry->second == kpp.key)
+        {
+            pending.erase(entry);
+            remainingPerKey[kpp.key]--;
+            numRemoved++;
+            continue;
+        }
+        leafNode->kppArray[numKept++] = kpp;
+    }
+    for (int i = numKept; i < Fanout; i++)
+    {
+        leafNode->kppArray[i] = KeyPointerPair<Key, Value>();
+    }
+    leafNode->numKeys = numKept;
+    return numRemoved;
+}
+
+template <typename Key, typename Value, int Fanout>
+int BPTree<Key, Value, Fanout>::removeRecordPointers(const vector<KeyPointerPair> &sortedKpps)
+{
+    if (root == nullptr || sortedKpps.empty())
+    {
+        return 0;
+    }
+    unordered_map<Value, Key> pending; // Pointer -> key of the pairs still to remove
+    unordered_map<Key, int> remainingPerKey;
+    for (const KeyPointerPair &kpp : sortedKpps)
+    {
+        pending[kpp.pointer] = kpp.key;
+        remainingPerKey[kpp.key]++;
+    }
+
+    int numRemoved = 0;
+    for (size_t i = 0; i < sortedKpps.size(); i++)
+    {
+        Key key = sortedKpps[i].key;
+        if (i > 0 && key == sortedKpps[i - 1].key)
+        {
+            continue; // Already looked up together with the previous pair
+        }
+
+        // Walk right from the leftmost LeafNode that can hold the key, until every pair of the key is
+        // removed or the keys get greater than it
+        LeafNode *leafNode = static_cast<LeafNode *>(getLeafNode(key, false));
+        while (leafNode != nullptr && remainingPerKey[key] > 0)
+        {
+            numRemoved += removeFromLeaf(leafNode, pending, remainingPerKey);
+            if (leafNode->numKeys > 0 && key < leafNode->kppArray[leafNode->numKeys - 1].key)
+            {
+                break;
+            }
+            leafNode = leafNode->nextNode;
+        }
+    }
+
+    // Duplicate keys that spill over a split are not always reachable from getLeafNode(),
+    // so look for the pairs that were not found in every LeafNode
+    for (LeafNode *leafNode = getFirstLeafNode(); leafNode != nullptr && !pending.empty(); leafNode = leafNode->nextNode)
+    {
+        numRemoved += removeFromLeaf(leafNode, pending, remainingPerKey);
+    }
+    return numRemoved;
+}
+
+// Number of entries that the node at position index gets when numEntries entries are spread evenly over numNodes nodes
+static int getSpreadSize(size_t numEntries, size_t numNodes, size_t index)
+{
+    return numEntries / numNodes + (index < numEntries % numNodes ? 1 : 0);
+}
+
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::bulkLoad(const vector<KeyPointerPair> &sortedKpps, double fillFactor)
+{
+    if (root != nullptr)
+    {
+        throw runtime_error("Bulk loading needs an empty B+ tree");
+    }
+    if (!(fillFactor > 0 && fillFactor <= 1))
+    {
+        throw invalid_argument("Fill factor of a B+ tree must be in (0, 1]");
+    }
+    for (size_t i = 1; i < sortedKpps.size(); i++)
+    {
+        if (sortedKpps[i].key < sortedKpps[i - 1].key)
+        {
+            throw invalid_argument("Bulk loading needs the KeyPointerPairs sorted by key");
+        }
+    }
+    if (sortedKpps.empty())
+    {
+        return;
+    }
+
+    // Fill the LeafNodes from left to right and link them up
+    vector<Node *> nodes;
+    vector<Key> minKeys; // Smallest key under each node of the level, the separator keys of their parents
+    int keysPerLeaf = max(1, min(n, (int)lround(n * fillFactor)));
+    size_t numLeaves = (sortedKpps.size() + keysPerLeaf - 1) / keysPerLeaf;
+    size_t next = 0;
+    LeafNode *previous = nullptr;
+    for (size_t i = 0; i < numLeaves; i++)
+    {
+        LeafNode *leafNode = arena.createLeafNode();
+        int numKeys = getSpreadSize(sortedKpps.size(), numLeaves, i);
+        for (int k = 0; k < numKeys; k++)
+        {
+            leafNode->kppArray[k] = sortedKpps[next++];
+        }
+        leafNode->numKeys = numKeys;
+        if (previous != nullptr)
+        {
+            previous->nextNode = leafNode;
+        }
+        previous = leafNode;
+        nodes.push_back(leafNode);
+        minKeys.push_back(leafNode->kppArray[0].key);
+    }
+
+    // Build each level of NonLeafNodes over the level below, until a single root is left.
+    // At least 3 children per node, so spreading them evenly never leaves a node with one child
+    int childrenPerNode = max(3, min(n + 1, (int)lround((n + 1) * fillFactor)));
+    for (int level = 1; nodes.size() > 1; level++)
+    {
+        size_t numParents = (nodes.size() + childrenPerNode - 1) / childrenPerNode;
+        vector<Node *> parents;
+        vector<Key> parentMinKeys;
+        size_t child = 0;
+        for (size_t i = 0; i < numParents; i++)
+        {
+            NonLeafNode *parent = arena.createNonLeafNode(level);
+            int numChildren = getSpreadSize(nodes.size(), numParents, i);
+            parentMinKeys.push_back(minKeys[child]);
+            for (int c = 0; c < numChildren; c++, child++)
+            {
+                parent->ptrArray[c] = nodes[child];
+                if (c > 0)
+                {
+                    parent->keyArray[c - 1] = minKeys[child];
+                }
+            }
+            parent->numKeys = numChildren - 1;
+            parents.push_back(parent);
+        }
+        nodes.swap(parents);
+        minKeys.swap(parentMinKeys);
+    }
+    root = nodes[0];
+}
+
+template <typename Key, typename Value, int Fanout>
+void BPTree<Key, Value, Fanout>::clear()
+{
+    root = nullptr;
+    arena.clear();
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Instantiations ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+// The record index, and the fanouts compared by the fanout sweep of main.cpp
+template class BPTree<int, RecordPointer, 8>;
+template class BPTree<int, RecordPointer, getCacheLineFanout<int>()>;
+template class BPTree<int, RecordPointer, 32>;
+template class BPTree<int, RecordPointer, 64>;
+template class BPTree<int, RecordPointer, 128>;
+template class BPTree<int, RecordPointer, getPageFanout<int, RecordPointer>()>;
+template class BPTree<int, RecordPointer, 256>;
@@ -2,53 +2,149 @@
 #include <string>
 #include <vector>
 #include "tree_helper.h"
+#include "node_arena.h"
 using namespace std;
 
+/**
+ * A record that was moved from one place to another, e.g. by compaction
+*/
+template <typename Key, typename Value>
+struct PointerMove {
+    Key key;
+    Value oldPointer;
+    Value newPointer;
+};
+
 /**
  * Stores a reference to one instance of an entire B+ tree
+ *
+ * The nodes are allocated from the tree's own NodeArena and belong to the
+ * tree: they are freed together with it, so a tree cannot be copied.
+ *
+ * The fanout is fixed at compile time, so the node arrays are sized
+ * exactly and the loops over them have constant bounds. The fanouts the
+ * tree is compiled for are instantiated at the end of b_plus_tree.cpp.
+ *
+ * @tparam Key Type of the keys, compared with < and == and hashable with std::hash
+ * @tparam Value Type of the pointers to the records, hashable with std::hash
+ * @tparam Fanout Maximum number of keys that a LeafNode or NonLeafNode can hold,
+ * e.g. getCacheLineFanout() or getPageFanout()
 */
+template <typename Key, typename Value, int Fanout>
 class BPTree {
     public:
+        using KeyPointerPair = ::KeyPointerPair<Key, Value>;
+        using LeafNode = ::LeafNode<Key, Value, Fanout>;
+        using NonLeafNode = ::NonLeafNode<Key, Fanout>;
+
+        // Maximum number of keys that a LeafNode or NonLeafNode can hold
+        static constexpr int n = Fanout;
+
         /**
          * Stores the highest level node.
          * If the tree consists of only LeafNode, the root node is the leftmost node
         */
         Node* root = nullptr;
 
+        BPTree() = default;
+        BPTree(const BPTree&) = delete;
+        BPTree& operator=(const BPTree&) = delete;
+
         // Return height of tree
-        int getTreeHeight();
+        int getTreeHeight() const;
 
         // Search for exact match of key
-        vector<tuple<int, int>> exactSearch(int key);
+        vector<Value> exactSearch(Key key) const;
 
         // Search for key within a range of values
-        vector<tuple<int, int>> rangeSearch(int low, int high);
+        vector<Value> rangeSearch(Key low, Key high) const;
 
         /**
          * Return number of non-leaf nodes scanned
          * To be used together with either exactSearch() or rangeSearch()
          * For rangeSearch(), use the argument fow 'low' as the argument for this function
         */
-        int getNumIndexNodes(int key);
+        int getNumIndexNodes(Key key) const;
 
         // Return total number of LeafNodes and NonLeafNodes
-        int getTotalNumNodes();
+        int getTotalNumNodes() const;
+
+        // Return the memory taken by the nodes
+        NodeMemoryUsage getMemoryUsage() const;
 
         /**
          * Prints out all of the leaf nodes
         */
-        void displayLeafNodes();
+        void displayLeafNodes() const;
 
         // Prints out the keys of the root node
-        void displayRootNode();
+        void displayRootNode() const;
 
         // Insert a new key into the B+ tree
-        void insertKey(int key, int blockId, int blockOffset);
+        void insertKey(Key key, const Value &pointer);
+
+        /**
+         * Build the B+ tree bottom-up from KeyPointerPairs sorted by key,
+         * instead of inserting them one by one.
+         *
+         * The LeafNodes are filled from left to right and linked, then each
+         * level of NonLeafNodes is built over the level below, with the
+         * smallest key under a child as its separator key. No node is split
+         * and every key is placed once.
+         *
+         * @param sortedKpps Pairs sorted by key. Pairs with the same key keep their order
+         * @param fillFactor Share of each node that is filled, in (0, 1]. The keys are
+         * spread evenly, so the last node of a level is not left nearly empty.
+         * 1 gives the fewest nodes, less leaves room for later inserts without splits
+         *
+         * The tree must be empty.
+        */
+        void bulkLoad(const vector<KeyPointerPair> &sortedKpps, double fillFactor = 1.0);
 
         // Delete a key from the B+ tree
-        void deleteKey(int key);
+        void deleteKey(Key key);
+
+        /**
+         * Point the KeyPointerPairs of records that were moved to another
+         * block or slot at their new addresses, in one pass over the LeafNodes.
+         * The moves are applied in order, so a record may move more than once.
+         *
+         * @return Number of KeyPointerPairs rewritten
+        */
+        int updateRecordPointers(const vector<PointerMove<Key, Value>> &moves);
+
+        /**
+         * Remove the KeyPointerPairs of deleted records, given sorted by key.
+         *
+         * Deletion is lazy: the pairs are taken out of their LeafNodes, but
+         * underfull nodes are neither merged nor rebalanced, and the keys of
+         * the NonLeafNodes are left as they are. They still route searches
+         * correctly, since every remaining key stays within its bounds.
+         * Each distinct key is looked up once for all of its records.
+         *
+         * @return Number of KeyPointerPairs removed
+        */
+        int removeRecordPointers(const vector<KeyPointerPair> &sortedKpps);
+
+        // Remove every key and give the memory of all nodes back
+        void clear();
   
     private:
+        // Allocates the nodes of this tree
+        NodeArena<LeafNode, NonLeafNode> arena;
+
+        /**
+         * Checked casts from Node, the replacement for dynamic_cast.
+         * Return nullptr if node is nullptr or is the other kind of node.
+        */
+        static LeafNode* asLeafNode(Node* node) {
+            return node != nullptr && node->isLeaf() ? static_cast<LeafNode*>(node) : nullptr;
+        }
+
+        static NonLeafNode* asNonLeafNode(Node* node) {
+            return node != nullptr && !node->isLeaf() ? static_cast<NonLeafNode*>(node) : nullptr;
+        }
+
         /**
          * Helper function
          * 
@@ -76,7 +172,7 @@ class BPTree {
          * if this is called in an insert-related function. Set to false if
          * this is called in a search-related function
         */
-        Node* getLeafNode(int key, bool insert);
+        Node* getLeafNode(Key key, bool insert) const;
 
         /**
          * Helper function for insertKey()
@@ -99,16 +195,19 @@ class BPTree {
          * @param nextPtr After appending the key, this pointer will be at the right
          * of the key
         */
-        void insertInternalNode(int key, vector<NonLeafNode*> nodePath, Node* nextPtr);
+        void insertInternalNode(Key key, vector<NonLeafNode*> nodePath, Node* nextPtr);
 
         // Return current number of keys in the target LeafNode
         int getNumKeys(LeafNode* node);
 
+        // Return the leftmost LeafNode of the linked list
+        LeafNode* getFirstLeafNode() const;
+
         // Return current number of keys in the target LeafNode
         int getNumKeysNL(NonLeafNode* node);
 
         //remove internal nodes in tree.
-        void removeInternalNode(int key, NonLeafNode *parent, Node *child);
+        void removeInternalNode(Key key, NonLeafNode *parent, Node *child);
 
         /**
          * Helper function for deleteKey()
@@ -129,4 +228,13 @@ class BPTree {
 
         //find parent node of node
         Node* findParent(Node *current, Node *child);
-};
\ No newline at end of file
+};
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Record index ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+// B+ tree over the numVotes of the records, with NonLeafNodes whose keys fill one cache line
+using RecordIndex = BPTree<int, RecordPointer, getCacheLineFanout<int>()>;
+using RecordKeyPointerPair = RecordIndex::KeyPointerPair;
+using RecordMove = PointerMove<int, RecordPointer>;
@@ -1,38 +1,162 @@
 #include "block.h"
 #include "record.h"
+#include "crc32c.h"
+#include "predicate_kernels.h"
 #include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+// Byte positions of the header fields
+static const int NUM_RECORDS_POSITION = 0;
+static const int NUM_SLOTS_POSITION = 2;
+static const int FREE_SPACE_OFFSET_POSITION = 4;
+static const int FIRST_FREE_SLOT_POSITION = 6;
+static const int CHECKSUM_POSITION = 8;
+static const int LAYOUT_POSITION = 12;
+static const int TOMBSTONES_POSITION = 14;
+static_assert(TOMBSTONES_POSITION == Block::FIXED_HEADER_SIZE, "The tombstone bitmap ends the header");
+
+Block::Block(BlockLayout layout)
+{
+    data.fill(0);
+    writeHeaderField(FREE_SPACE_OFFSET_POSITION, BLOCK_SIZE); // Record data area is empty
+    writeHeaderField(FIRST_FREE_SLOT_POSITION, NO_FREE_SLOT);
+    writeHeaderField(LAYOUT_POSITION, (uint16_t)layout);
+}
+
+uint16_t Block::readHeaderField(int position) const
+{
+    uint16_t value;
+    std::memcpy(&value, data.data() + position, sizeof(value));
+    return value;
+}
+
+void Block::writeHeaderField(int position, uint16_t value)
+{
+    std::memcpy(data.data() + position, &value, sizeof(value));
+}
+
+uint16_t Block::readSlot(int index) const
+{
+    return readHeaderField(HEADER_SIZE + index * SLOT_SIZE);
+}
+
+void Block::writeSlot(int index, uint16_t entry)
+{
+    writeHeaderField(HEADER_SIZE + index * SLOT_SIZE, entry);
+}
+
+bool Block::readTombstone(int index) const
+{
+    return data[TOMBSTONES_POSITION + index / 8] >> (index % 8) & 1;
+}
+
+void Block::writeTombstone(int index, bool tombstoned)
+{
+    uint8_t &bits = data[TOMBSTONES_POSITION + index / 8];
+    bits = tombstoned ? bits | 1 << (index % 8) : bits & ~(1 << (index % 8));
+}
+
+void Block::writeRecord(int index, const Record &record)
+{
+    if (getLayout() == BlockLayout::PAX)
+    {
+        record.serializeFields(data.data() + TCONST_COLUMN + index * Record::TCONST_SIZE,
+                               data.data() + AVERAGE_RATING_COLUMN + index * sizeof(float),
+                               data.data() + NUM_VOTES_COLUMN + index * sizeof(int));
+    }
+    else
+    {
+        record.serialize(data.data() + readSlot(index));
+    }
+}
+
+Record Block::readRecord(int index) const
+{
+    if (getLayout() == BlockLayout::PAX)
+    {
+        return Record::deserializeFields(data.data() + TCONST_COLUMN + index * Record::TCONST_SIZE,
+                                         data.data() + AVERAGE_RATING_COLUMN + index * sizeof(float),
+                                         data.data() + NUM_VOTES_COLUMN + index * sizeof(int));
+    }
+    return Record::deserialize(data.data() + readSlot(index));
+}
 
 bool Block::insertRecord(const Record &record, int index)
 {
-    // Check if the index is within bounds and the slot is unoccupied
-    if (index >= 0 && index < BLOCK_CAPACITY && !slotsOccupancy.test(index))
+    int numSlots = getNumSlots();
+    if (index >= 0 && index < numSlots && !isSlotOccupied(index))
+    {
+        // Reuse the space of the deleted record in this slot, after unlinking it from the list of empty slots
+        uint16_t recordOffset = readSlot(index) & ~EMPTY_SLOT_FLAG;
+        uint16_t nextFreeSlot = readHeaderField(recordOffset);
+        int linkPosition = FIRST_FREE_SLOT_POSITION;
+        while (readHeaderField(linkPosition) != index)
+        {
+            linkPosition = readSlot(readHeaderField(linkPosition)) & ~EMPTY_SLOT_FLAG;
+        }
+        writeHeaderField(linkPosition, nextFreeSlot);
+        writeSlot(index, recordOffset); // Mark the slot as occupied
+        writeRecord(index, record);
+    }
+    else if (index == numSlots && index < BLOCK_CAPACITY && getLayout() == BlockLayout::PAX)
+    {
+        // Append a new slot, its record space is already reserved in every column
+        writeSlot(index, NUM_VOTES_COLUMN + index * sizeof(int));
+        writeHeaderField(NUM_SLOTS_POSITION, numSlots + 1);
+        writeRecord(index, record);
+    }
+    else if (index == numSlots && index < BLOCK_CAPACITY)
     {
-        records[index] = record;   // Insert the record
-        slotsOccupancy.set(index); // Mark the slot as occupied
-        return true;               // Indicate successful insertion
+        // Append a new slot and take the record space from the end of the free space
+        uint16_t recordOffset = readHeaderField(FREE_SPACE_OFFSET_POSITION) - Record::SERIALIZED_SIZE;
+        writeSlot(index, recordOffset);
+        writeHeaderField(NUM_SLOTS_POSITION, numSlots + 1);
+        writeHeaderField(FREE_SPACE_OFFSET_POSITION, recordOffset);
+        writeRecord(index, record);
     }
-    return false; // Slot is already occupied or index out of bounds
+    else
+    {
+        return false; // Slot is already occupied or index out of bounds
+    }
+    writeHeaderField(NUM_RECORDS_POSITION, readHeaderField(NUM_RECORDS_POSITION) + 1);
+    return true; // Indicate successful insertion
 }
 
 bool Block::deleteRecord(int index)
 {
     // Check if the index is within bounds and the slot is occupied
-    if (index >= 0 && index < BLOCK_CAPACITY && slotsOccupancy.test(index))
+    if (isSlotOccupied(index))
     {
-        records[index] = std ::nullopt; // Delete the record
-        slotsOccupancy.reset(index);    // Mark the slot as unoccupied
-        return true;                    // Indicate successful deletion
+        // Push the slot onto the list of empty slots, the link is stored where the record (PAX: its numVotes) was
+        uint16_t recordOffset = readSlot(index);
+        writeHeaderField(recordOffset, readHeaderField(FIRST_FREE_SLOT_POSITION));
+        writeHeaderField(FIRST_FREE_SLOT_POSITION, index);
+        writeSlot(index, recordOffset | EMPTY_SLOT_FLAG); // Mark the slot as unoccupied, the space is kept for reuse
+        writeHeaderField(NUM_RECORDS_POSITION, readHeaderField(NUM_RECORDS_POSITION) - 1);
+        writeTombstone(index, false);
+        return true; // Indicate successful deletion
     }
     return false; // Slot is already unoccupied or index out of bounds
 }
 
+bool Block::markDeleted(int index)
+{
+    if (isRecordLive(index))
+    {
+        writeTombstone(index, true);
+        return true;
+    }
+    return false; // Slot is unoccupied, already tombstoned or out of bounds
+}
+
 bool Block::updateRecord(int index, const Record &record)
 {
     // Check if the index is within bounds and the slot is occupied
-    if (index >= 0 && index < BLOCK_CAPACITY && slotsOccupancy.test(index))
+    if (isSlotOccupied(index))
     {
-        records[index] = record; // Update the record
-        return true;             // Indicate successful update
+        writeRecord(index, record); // Update the record
+        return true;                // Indicate successful update
     }
     return false; // Slot is unoccupied or index out of bounds
 }
@@ -42,14 +166,14 @@ void Block::printBlock() const
     std::cout << "Block contents:" << std::endl;
     for (int i = 0; i < BLOCK_CAPACITY; i++)
     {
-        if (records[i] == std::nullopt)
+        if (!isSlotOccupied(i))
         {
 
             std::cout << "Slot " << i << " is empty" << std::endl;
         }
         else
         {
-            records[i]->print();
+            retrieveRecord(i).print();
         }
     }
     std::cout << std::endl;
@@ -57,17 +181,50 @@ void Block::printBlock() const
 
 int Block::getNumRecordsStored() const
 {
-    return slotsOccupancy.count();
+    int numTombstones = 0;
+    for (int i = 0; i < TOMBSTONE_BITMAP_SIZE; i++)
+    {
+        numTombstones += __builtin_popcount(data[TOMBSTONES_POSITION + i]);
+    }
+    return readHeaderField(NUM_RECORDS_POSITION) - numTombstones;
+}
+
+int Block::getNumFreeSlots() const
+{
+    return BLOCK_CAPACITY - readHeaderField(NUM_RECORDS_POSITION);
+}
+
+int Block::getNumSlots() const
+{
+    return readHeaderField(NUM_SLOTS_POSITION);
+}
+
+bool Block::isSlotOccupied(int index) const
+{
+    return index >= 0 && index < getNumSlots() && !(readSlot(index) & EMPTY_SLOT_FLAG);
+}
+
+bool Block::isTombstoned(int index) const
+{
+    return isSlotOccupied(index) && readTombstone(index);
+}
+
+bool Block::isRecordLive(int index) const
+{
+    return isSlotOccupied(index) && !readTombstone(index);
 }
 
 int Block::getFreeIndex() const
 {
-    for (int i = 0; i < BLOCK_CAPACITY; i++)
+    uint16_t firstFreeSlot = readHeaderField(FIRST_FREE_SLOT_POSITION);
+    if (firstFreeSlot != NO_FREE_SLOT)
     {
-        if (!slotsOccupancy.test(i))
-        {
-            return i;
-        }
+        return firstFreeSlot;
+    }
+    int numSlots = getNumSlots();
+    if (numSlots < BLOCK_CAPACITY)
+    {
+        return numSlots; // A new slot can still be appended
     }
     return -1; // No free slots available
 }
@@ -75,11 +232,12 @@ int Block::getFreeIndex() const
 std::vector<Record> Block::retrieveAllRecords() const
 {
     std::vector<Record> allRecords;
-    for (int i = 0; i < BLOCK_CAPACITY; i++)
+    int numSlots = getNumSlots();
+    for (int i = 0; i < numSlots; i++)
     {
-        if (slotsOccupancy.test(i))
+        if (isRecordLive(i))
         {
-            allRecords.push_back(*records[i]);
+            allRecords.push_back(readRecord(i));
         }
     }
     return allRecords;
@@ -87,9 +245,81 @@ std::vector<Record> Block::retrieveAllRecords() const
 
 Record Block::retrieveRecord(int index) const
 {
-    if (index >= 0 && index < BLOCK_CAPACITY && slotsOccupancy.test(index))
+    if (isSlotOccupied(index))
     {
-        return *records[index];
+        return readRecord(index);
     }
     throw std::runtime_error("Record not found");
-}
\ No newline at end of file
+}
+
+BlockLayout Block::getLayout() const
+{
+    return (BlockLayout)readHeaderField(LAYOUT_POSITION);
+}
+
+/**
+ * @brief In a PAX page the numVotes column and the slot directory are tested with the vector kernels, in a
+ * row page the numVotes of each occupied slot is read from its record. Tombstoned records are masked out.
+ */
+void Block::selectByNumVotes(int low, int high, SelectionMask &selection) const
+{
+    selection.fill(0);
+    int numSlots = getNumSlots();
+    if (getLayout() == BlockLayout::PAX)
+    {
+        PredicateKernels::selectInRange(data.data() + NUM_VOTES_COLUMN, numSlots, low, high, selection.data());
+        if (readHeaderField(FIRST_FREE_SLOT_POSITION) != NO_FREE_SLOT) // Only then are some of the slots empty
+        {
+            SelectionMask occupied{};
+            PredicateKernels::selectOccupied(data.data() + HEADER_SIZE, numSlots, occupied.data());
+            for (size_t word = 0; word < selection.size(); word++)
+            {
+                selection[word] &= occupied[word];
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < numSlots; i++)
+        {
+            uint16_t slot = readSlot(i);
+            if (slot & EMPTY_SLOT_FLAG)
+            {
+                continue;
+            }
+            int numVotes;
+            std::memcpy(&numVotes, data.data() + slot + Record::TCONST_SIZE + sizeof(float), sizeof(numVotes));
+            if (numVotes >= low && numVotes <= high)
+            {
+                selection[i / 64] |= 1ULL << (i % 64);
+            }
+        }
+    }
+
+    SelectionMask tombstones{};
+    std::memcpy(tombstones.data(), data.data() + TOMBSTONES_POSITION, TOMBSTONE_BITMAP_SIZE); // Bit i of the bitmap is bit i of the mask on little-endian CPUs
+    for (size_t word = 0; word < selection.size(); word++)
+    {
+        selection[word] &= ~tombstones[word];
+    }
+}
+
+uint32_t Block::computeChecksum() const
+{
+    uint32_t crc = Crc32c::compute(data.data(), CHECKSUM_POSITION);
+    int afterChecksum = CHECKSUM_POSITION + sizeof(uint32_t);
+    return Crc32c::compute(data.data() + afterChecksum, BLOCK_SIZE - afterChecksum, crc);
+}
+
+void Block::updateChecksum()
+{
+    uint32_t checksum = computeChecksum();
+    std::memcpy(data.data() + CHECKSUM_POSITION, &checksum, sizeof(checksum));
+}
+
+bool Block::verifyChecksum() const
+{
+    uint32_t storedChecksum;
+    std::memcpy(&storedChecksum, data.data() + CHECKSUM_POSITION, sizeof(storedChecksum));
+    return storedChecksum == computeChecksum();
+}
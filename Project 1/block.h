@@ -2,51 +2,123 @@
  * @file block.h
  * @brief Defines the Block class for managing fixed-size memory blocks to store serialized records.
  *
- * The Block class simulates a fixed-size memory block, specifically designed to store
- * a limited number of records. Each record, typically serialized into a 19-byte format,
- * is represented here by a Record object for simplicity and architecture neutrality.
- * The block is capable of holding up to 10 records, aligning with a fixed block size of 200 bytes.
- * This class leverages a std::array of std::optional<Record> to simulate the block storage,
- * allowing for efficient management of occupied and unoccupied slots within the block. The occupancy
- * of each slot is tracked using a std::bitset, enabling quick checks and updates for record
- * insertion, deletion, and updates. This design facilitates block management and record inspection
- * while maintaining alignment and efficient access within the simulated environment.
+ * The Block class is a genuine page of BLOCK_SIZE bytes (200 by default, see page_config.h): its
+ * only member is the byte buffer that is written to disk unchanged. Records are serialized into it with Record::serialize() (18 bytes each) and
+ * located through a slotted-page layout:
+ *
+ *   [ header | slot directory -> ...free space... <- record data ]
+ *
+ * - The header stores the number of records, the number of slots in the slot directory, the
+ *   free-space offset, which is where the record data area currently begins, the first slot
+ *   of the list of empty slots, a CRC32C checksum of the rest of the page, the layout of the
+ *   page and the tombstone bitmap.
+ * - The slot directory grows forward from the header. Slot i holds the byte offset of the record
+ *   with index i, and a flag marking the slot as empty once the record has been deleted.
+ * - Record data grows backward from the end of the block.
+ *
+ * A page can use the PAX layout instead (BlockLayout::PAX), which stores each attribute of the
+ * records contiguously after the slot directory:
+ *
+ *   [ header | slot directory | numVotes column | averageRating column | tconst column ]
+ *
+ * Record i then lives at position i of every column, and its slot holds the offset of its numVotes
+ * value. A scan that filters on numVotes reads one contiguous array of BLOCK_CAPACITY ints per page,
+ * which selectByNumVotes() tests with the vectorised kernels of PredicateKernels. Both layouts hold
+ * the same number of records and behave the same through this interface. The layout is recorded in
+ * every page, so a data file can mix them.
+ *
+ * The index of a record within the block is its slot number, which stays stable across deletions.
+ * Since records have a fixed size, the space of a deleted record is reused by the next record
+ * inserted into the same slot. Empty slots are chained into a list through the first bytes of their
+ * dead record, so getFreeIndex() is O(1). With a 16-byte header, a 2-byte slot and an 18-byte
+ * record, a 200-byte block holds 9 records.
+ *
+ * A delete can be logical first: markDeleted() sets the record's bit in the tombstone bitmap, and
+ * the record is no longer returned, while its slot stays occupied. deleteRecord() then removes it for
+ * good once the index no longer refers to it, so a slot is never reused while index entries point at it.
+ * The bitmap has one bit per record the block can hold, so it grows with the block size.
+ *
+ * The checksum is only brought up to date when the page is written to storage (updateChecksum), and
+ * checked when it is read back (verifyChecksum), so changing a cached page costs nothing extra.
  */
 
 #ifndef BLOCK_H
 #define BLOCK_H
 
+#include "page_config.h"
 #include "record.h"
 #include <vector>
 #include <string>
-#include <bitset>
-#include <optional>
 #include <array>
+#include <cstdint>
+
+// How the records are arranged inside a page, see the description of Block
+enum class BlockLayout : uint16_t
+{
+    Row = 0, // Record after record, from the end of the page
+    PAX = 1  // Each attribute in its own column
+};
 
 class Block
 {
 public:
     // Block metadata
-    static const int BLOCK_CAPACITY = 200 / sizeof(Record); // Maximum number of records in a block
-    std::bitset<BLOCK_CAPACITY> slotsOccupancy;             // All bits are 0 (empty) by default
+    static const int BLOCK_SIZE = CONFIGURED_BLOCK_SIZE;                                                  // Size of the block in bytes
+    static const int FIXED_HEADER_SIZE = 5 * sizeof(uint16_t) + sizeof(uint32_t); // numRecords, numSlots, freeSpaceOffset, firstFreeSlot, checksum, layout
+    static const int SLOT_SIZE = sizeof(uint16_t);                                  // One slot directory entry
+    // Maximum number of records in a block, each needs a slot, its data and a bit of the tombstone bitmap
+    static const int BLOCK_CAPACITY = (BLOCK_SIZE - FIXED_HEADER_SIZE) * 8 / ((SLOT_SIZE + Record::SERIALIZED_SIZE) * 8 + 1);
+    static const int TOMBSTONE_BITMAP_SIZE = (BLOCK_CAPACITY + 7) / 8;
+    static const int HEADER_SIZE = FIXED_HEADER_SIZE + TOMBSTONE_BITMAP_SIZE;
 
-    Block()
-    {
-        slotsOccupancy.reset(); // Ensure all slots are marked as empty initially
-    }
+    // One bit per slot, bit i of word i / 64 stands for the record with index i
+    using SelectionMask = std::array<uint64_t, (BLOCK_CAPACITY + 63) / 64>;
+
+    explicit Block(BlockLayout layout = BlockLayout::Row);
 
     bool insertRecord(const Record &record, int index);
     bool deleteRecord(int index);
+    bool markDeleted(int index); // Tombstone the record, returns false if it is not live
     bool updateRecord(int index, const Record &record);
     void printBlock() const;
-    std::array<std::optional<Record>, BLOCK_CAPACITY> getRecords() const { return records; }
-    int getNumRecordsStored() const;
+    int getNumRecordsStored() const; // Live records, tombstoned ones are not counted
+    int getNumFreeSlots() const; // Slots that can take a new record, tombstoned records still hold theirs
+    int getNumSlots() const; // Number of slots in the slot directory, occupied or not
+    bool isSlotOccupied(int index) const;
+    bool isTombstoned(int index) const;
+    bool isRecordLive(int index) const; // Occupied and not tombstoned
     int getFreeIndex() const; // Returns the index of the first free slot, or -1 if the block is full
-    std::vector<Record> retrieveAllRecords() const;
-    Record retrieveRecord(int index) const;
+    std::vector<Record> retrieveAllRecords() const; // Live records only
+    Record retrieveRecord(int index) const; // Any occupied slot, including tombstoned records
+    BlockLayout getLayout() const;
+
+    // Select the live records with low <= numVotes <= high. Vectorised for BlockLayout::PAX pages
+    void selectByNumVotes(int low, int high, SelectionMask &selection) const;
+
+    uint32_t computeChecksum() const; // CRC32C of the page, leaving out the checksum field
+    void updateChecksum();
+    bool verifyChecksum() const;
 
 private:
-    std::array<std::optional<Record>, BLOCK_CAPACITY> records;
+    static const uint16_t EMPTY_SLOT_FLAG = 0x8000; // Set in a slot entry once its record is deleted
+    static const uint16_t NO_FREE_SLOT = 0xFFFF;    // End of the list of empty slots
+    static_assert(BLOCK_SIZE <= EMPTY_SLOT_FLAG, "Record offsets must not overlap the empty slot flag");
+
+    // Start of the columns of a BlockLayout::PAX page
+    static const int NUM_VOTES_COLUMN = HEADER_SIZE + BLOCK_CAPACITY * SLOT_SIZE;
+    static const int AVERAGE_RATING_COLUMN = NUM_VOTES_COLUMN + BLOCK_CAPACITY * sizeof(int);
+    static const int TCONST_COLUMN = AVERAGE_RATING_COLUMN + BLOCK_CAPACITY * sizeof(float);
+
+    std::array<uint8_t, BLOCK_SIZE> data;
+
+    uint16_t readHeaderField(int position) const;
+    void writeHeaderField(int position, uint16_t value);
+    uint16_t readSlot(int index) const;
+    void writeSlot(int index, uint16_t entry);
+    bool readTombstone(int index) const;
+    void writeTombstone(int index, bool tombstoned);
+    void writeRecord(int index, const Record &record); // Into the space of an occupied slot
+    Record readRecord(int index) const;
 };
 
 #endif // BLOCK_H
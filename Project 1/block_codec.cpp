@@ -0,0 +1,152 @@
+#include "block_codec.h"
+#include <cstring>
+#include <stdexcept>
+
+static const size_t MIN_MATCH = 4;       // Shortest match worth an offset, shorter ones stay literals
+static const size_t MAX_OFFSET = 65535;  // Offsets are stored in 2 bytes
+static const int HASH_BITS = 12;         // 4096 hash table entries
+static const size_t NO_POSITION = SIZE_MAX;
+
+static uint32_t readSequence(const uint8_t *position)
+{
+    uint32_t sequence;
+    std::memcpy(&sequence, position, sizeof(sequence));
+    return sequence;
+}
+
+static uint32_t hashSequence(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Store the part of a length that did not fit in its nibble as 255-continuation bytes
+static void writeExtendedLength(std::vector<uint8_t> &output, size_t length)
+{
+    while (length >= 255)
+    {
+        output.push_back(255);
+        length -= 255;
+    }
+    output.push_back(length);
+}
+
+static size_t readExtendedLength(const std::vector<uint8_t> &input, size_t &position)
+{
+    size_t length = 0;
+    uint8_t byte;
+    do
+    {
+        if (position >= input.size())
+        {
+            throw std::runtime_error("Compressed block is truncated");
+        }
+        byte = input[position++];
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+static void writeLiterals(std::vector<uint8_t> &output, const uint8_t *literals, size_t numLiterals, size_t matchLength)
+{
+    size_t matchNibble = matchLength - MIN_MATCH;
+    output.push_back((numLiterals < 15 ? numLiterals : 15) << 4 | (matchNibble < 15 ? matchNibble : 15));
+    if (numLiterals >= 15)
+    {
+        writeExtendedLength(output, numLiterals - 15);
+    }
+    output.insert(output.end(), literals, literals + numLiterals);
+}
+
+std::vector<uint8_t> BlockCodec::compress(const uint8_t *data, size_t length)
+{
+    std::vector<uint8_t> output;
+    output.reserve(length + length / 255 + 16);
+    std::vector<size_t> lastPositions(1 << HASH_BITS, NO_POSITION); // Last position of every hashed 4-byte sequence
+
+    size_t anchor = 0; // Start of the literals not written yet
+    size_t position = 0;
+    while (position + MIN_MATCH <= length)
+    {
+        uint32_t sequence = readSequence(data + position);
+        size_t &lastPosition = lastPositions[hashSequence(sequence)];
+        size_t candidate = lastPosition;
+        lastPosition = position;
+        if (candidate == NO_POSITION || position - candidate > MAX_OFFSET || readSequence(data + candidate) != sequence)
+        {
+            position++;
+            continue;
+        }
+
+        size_t matchLength = MIN_MATCH;
+        while (position + matchLength < length && data[candidate + matchLength] == data[position + matchLength])
+        {
+            matchLength++;
+        }
+        writeLiterals(output, data + anchor, position - anchor, matchLength);
+        size_t offset = position - candidate;
+        output.push_back(offset & 0xFF);
+        output.push_back(offset >> 8);
+        if (matchLength - MIN_MATCH >= 15)
+        {
+            writeExtendedLength(output, matchLength - MIN_MATCH - 15);
+        }
+        position += matchLength;
+        anchor = position;
+    }
+
+    // The last pair carries the remaining literals and no match
+    writeLiterals(output, data + anchor, length - anchor, MIN_MATCH);
+    return output;
+}
+
+void BlockCodec::decompress(const std::vector<uint8_t> &compressed, uint8_t *destination, size_t length)
+{
+    size_t input = 0;
+    size_t output = 0;
+    while (input < compressed.size())
+    {
+        uint8_t token = compressed[input++];
+        size_t numLiterals = token >> 4;
+        if (numLiterals == 15)
+        {
+            numLiterals += readExtendedLength(compressed, input);
+        }
+        if (numLiterals > compressed.size() - input || numLiterals > length - output)
+        {
+            throw std::runtime_error("Compressed block is corrupt");
+        }
+        std::memcpy(destination + output, compressed.data() + input, numLiterals);
+        input += numLiterals;
+        output += numLiterals;
+        if (input == compressed.size())
+        {
+            break; // Last pair
+        }
+
+        if (compressed.size() - input < 2)
+        {
+            throw std::runtime_error("Compressed block is truncated");
+        }
+        size_t offset = compressed[input] | compressed[input + 1] << 8;
+        input += 2;
+        size_t matchLength = (token & 0x0F) + MIN_MATCH;
+        if ((token & 0x0F) == 15)
+        {
+            matchLength += readExtendedLength(compressed, input);
+        }
+        if (offset == 0 || offset > output || matchLength > length - output)
+        {
+            throw std::runtime_error("Compressed block is corrupt");
+        }
+        // Byte by byte, since a match may overlap the bytes it produces
+        for (size_t i = 0; i < matchLength; i++)
+        {
+            destination[output + i] = destination[output - offset + i];
+        }
+        output += matchLength;
+    }
+    if (output != length)
+    {
+        throw std::runtime_error("Compressed block has the wrong size");
+    }
+}
@@ -0,0 +1,32 @@
+/**
+ * @file block_codec.h
+ * @brief Defines the BlockCodec class, a small LZ77 codec in the style of LZ4 used to compress cold blocks.
+ *
+ * The compressed stream is a sequence of (literals, match) pairs. Every pair starts with a token byte
+ * whose high nibble is the number of literals and whose low nibble is the match length minus 4, both
+ * extended with 255-continuation bytes once they reach 15. The literals follow, then the match offset
+ * as 2 little-endian bytes. The last pair has literals only.
+ *
+ * Matches are found with a hash table of the 4-byte sequences seen so far, so compression is one
+ * greedy pass and decompression is a plain copy loop. Pages of records compress well: the tconst
+ * strings share their "tt" prefix and leading digits, neighbouring pages have the same header and
+ * slot directory, and unused space is zeroed.
+ */
+
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class BlockCodec
+{
+public:
+    static std::vector<uint8_t> compress(const uint8_t *data, size_t length);
+
+    // Decompress into exactly length bytes at destination. Throws std::runtime_error if the input is corrupt
+    static void decompress(const std::vector<uint8_t> &compressed, uint8_t *destination, size_t length);
+};
+
+#endif // BLOCK_CODEC_H
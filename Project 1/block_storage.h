@@ -0,0 +1,100 @@
+/**
+ * @file block_storage.h
+ * @brief Defines the BlockStorage interface, the block-level storage seen by the BufferPool and the Database.
+ *
+ * A BlockStorage stores fixed-size blocks under integer block IDs and models the time a physical access
+ * takes. DiskManager implements it for a single modelled disk. StripedDiskManager implements it on top
+ * of several DiskManagers, spreading the block IDs over them. Every device has its own head, so the
+ * access model is queried per device: a block ID belongs to one device and its track is a track of
+ * that device.
+ *
+ * Block IDs, disk sizes and block and record counts are 64-bit throughout, so a disk can be larger
+ * than 2 GB and hold more than 2^31 blocks.
+ */
+
+#ifndef BLOCK_STORAGE_H
+#define BLOCK_STORAGE_H
+
+#include "block.h"
+#include "io_stats.h"
+#include "tiered_block_arena.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Where the DiskManager keeps its blocks.
+ *
+ * InMemory keeps every block on the heap, which is fast but bounded by RAM and lost when the process exits.
+ * File maps every block ID to a fixed offset in a data file and moves the bytes with pread/pwrite,
+ * so the data set can outgrow RAM and the I/O being measured is real.
+ * MemoryMapped uses the same data file layout, but maps the file into memory, so blocks are read
+ * straight from the OS page cache and stay cached there across runs.
+ */
+enum class StorageMode
+{
+    InMemory,
+    File,
+    MemoryMapped
+};
+
+/**
+ * Expected access pattern of the upcoming reads, passed on to the OS as madvise/fadvise hints.
+ * Linear scans are Sequential, B+ tree lookups are Random.
+ */
+enum class AccessPattern
+{
+    Normal,
+    Sequential,
+    Random
+};
+
+class BlockStorage
+{
+public:
+    virtual ~BlockStorage() = default;
+
+    virtual void readBlock(int64_t blockId, Block &block) const = 0; // Copies the block into the caller's buffer, e.g. a buffer pool frame
+    /**
+     * Read blockIds[i] into *destinations[i] for every i, with many reads in flight where the storage allows it.
+     * onBlockRead(i) is called on the calling thread as soon as block i is in place, which may be out of order.
+     * Every block must exist.
+     */
+    virtual void readBlocks(const std::vector<int64_t> &blockIds, const std::vector<Block *> &destinations, const std::function<void(int)> &onBlockRead) const = 0;
+    virtual void writeBlock(int64_t blockId, const Block &block) = 0;
+    virtual bool hasBlock(int64_t blockId) const = 0;
+
+    // Pointer to the block inside the mapping in MemoryMapped mode, nullptr in the other modes
+    virtual const Block *getMappedBlock(int64_t blockId) const = 0;
+    virtual void adviseAccessPattern(AccessPattern accessPattern) = 0;
+
+    virtual int64_t createBlock() = 0;
+    virtual void deleteBlock(int64_t blockId) = 0;
+    virtual int64_t getNumRecordsStored() const = 0;
+    virtual int64_t getNumBlocksUsed() const = 0;
+    virtual int64_t getTotalBlockCapacity() const = 0;
+    virtual std::vector<int64_t> getAllBlockIds() const = 0; // In ascending order
+    virtual StorageMode getStorageMode() const = 0;
+    virtual const std::string &getDataFilePath() const = 0;
+
+    // Number of uncompressed chunks kept in InMemory mode, colder chunks are compressed. 0 turns tiering off
+    virtual void setMaxHotChunks(int maxHotChunks) = 0;
+    virtual TieringStats getTieringStats() const = 0;
+
+    // Pages whose checksum was checked when they were read from storage, and how many of them were corrupt
+    virtual long long getNumChecksumsVerified() const = 0;
+    virtual long long getNumChecksumFailures() const = 0;
+
+    // Model one physical access to the block: adds its seek, rotation and transfer time to ioStats and returns the total
+    virtual double simulateBlockAccessTime(int64_t blockId, IOStats &ioStats) = 0;
+    // Reset the access model to the start state given by the seed, the same seed always gives the same times
+    virtual void seedAccessModel(unsigned seed) = 0;
+    virtual int getNumDevices() const = 0;
+    virtual int getDeviceOf(int64_t blockId) const = 0;
+    virtual int getHeadPosition(int device) const = 0;
+    virtual int blockIdToTrack(int64_t blockId) const = 0; // Track of the block on its device
+    // Modelled time of accessing the block with the head of its device on headTrack, without moving the head
+    virtual double estimateAccessTime(int headTrack, int64_t blockId) const = 0;
+};
+
+#endif // BLOCK_STORAGE_H
@@ -0,0 +1,497 @@
+#include "buffer_pool.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ ReadPageGuard ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+ReadPageGuard::ReadPageGuard(ReadPageGuard &&other) noexcept
+    : bufferPool(std::exchange(other.bufferPool, nullptr)), frameId(other.frameId), blockId(other.blockId), block(other.block) {}
+
+ReadPageGuard &ReadPageGuard::operator=(ReadPageGuard &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        bufferPool = std::exchange(other.bufferPool, nullptr);
+        frameId = other.frameId;
+        blockId = other.blockId;
+        block = other.block;
+    }
+    return *this;
+}
+
+void ReadPageGuard::release()
+{
+    if (bufferPool != nullptr)
+    {
+        bufferPool->unpinFrame(frameId);
+        bufferPool = nullptr;
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ WritePageGuard ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+WritePageGuard::WritePageGuard(WritePageGuard &&other) noexcept
+    : bufferPool(std::exchange(other.bufferPool, nullptr)), frameId(other.frameId), blockId(other.blockId) {}
+
+WritePageGuard &WritePageGuard::operator=(WritePageGuard &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        bufferPool = std::exchange(other.bufferPool, nullptr);
+        frameId = other.frameId;
+        blockId = other.blockId;
+    }
+    return *this;
+}
+
+Block &WritePageGuard::getBlock()
+{
+    return bufferPool->frames[frameId];
+}
+
+void WritePageGuard::release()
+{
+    if (bufferPool != nullptr)
+    {
+        bufferPool->unpinFrame(frameId);
+        bufferPool = nullptr;
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ BufferPool ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+BufferPool::BufferPool(BlockStorage &storage, int numFrames, ReplacementPolicyType policyType, int lruK)
+    : storage(storage), frames(numFrames), frameBlockIds(numFrames, -1), dirtyFrames(numFrames, false), prefetchedFrames(numFrames, false),
+      pinCounts(numFrames, 0), averageCacheAccessTime(0.001), lastAccessTime(0),
+      scanRing(std::min(SCAN_RING_FRAMES, std::max(1, numFrames / 4)), -1), scanRingSlots(numFrames, -1), scanRingHand(0),
+      lastFetchedBlockId(-1), sequentialRunLength(0), numEvictions(0), numPrefetches(0)
+{
+    if (numFrames < 1)
+    {
+        throw std::invalid_argument("Buffer pool needs at least one frame");
+    }
+    if (policyType == ReplacementPolicyType::LRUK)
+    {
+        replacementPolicy = std::make_unique<LRUKPolicy>(numFrames, lruK);
+    }
+    else
+    {
+        replacementPolicy = std::make_unique<ClockPolicy>(numFrames);
+    }
+
+    // Hand out frames from the lowest index first
+    for (int frameId = numFrames - 1; frameId >= 0; frameId--)
+    {
+        freeFrames.push_back(frameId);
+    }
+}
+
+BufferPool::~BufferPool()
+{
+    try
+    {
+        flushAll();
+    }
+    catch (std::runtime_error &e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Find a frame that can receive a new block, evicting a block if every frame is in use.
+ * The time taken to write back a dirty victim is added to lastAccessTime.
+ *
+ * @return frameId
+ */
+int BufferPool::allocateFrame()
+{
+    if (!freeFrames.empty())
+    {
+        int frameId = freeFrames.back();
+        freeFrames.pop_back();
+        return frameId;
+    }
+
+    int frameId = replacementPolicy->evict();
+    if (frameId == -1)
+    {
+        throw std::runtime_error("Buffer pool has no frame to evict, every frame is pinned");
+    }
+
+    evictFrameContents(frameId);
+    return frameId;
+}
+
+/**
+ * @brief Find a frame of the scan ring that can receive a new block. Slots without a frame yet take one
+ * from the pool, after that the ring recycles its own frames in turn. Ring frames are never tracked by the
+ * replacement policy, so a scan only ever evicts blocks it loaded itself.
+ *
+ * @return frameId
+ */
+int BufferPool::allocateScanFrame()
+{
+    int ringSize = scanRing.size();
+    for (int step = 0; step < ringSize; step++)
+    {
+        int slot = scanRingHand;
+        scanRingHand = (scanRingHand + 1) % ringSize;
+
+        int frameId = scanRing[slot];
+        if (frameId == -1)
+        {
+            frameId = allocateFrame();
+        }
+        else if (pinCounts[frameId] > 0)
+        {
+            continue;
+        }
+        else if (frameBlockIds[frameId] != -1)
+        {
+            evictFrameContents(frameId);
+        }
+        scanRing[slot] = frameId;
+        scanRingSlots[frameId] = slot;
+        return frameId;
+    }
+    throw std::runtime_error("Scan ring has no frame to recycle, every frame is pinned");
+}
+
+/**
+ * @brief Drop the block held by an unpinned frame, writing it back first if it is dirty.
+ * The time taken by the write-back is added to lastAccessTime.
+ */
+void BufferPool::evictFrameContents(int frameId)
+{
+    int64_t victimBlockId = frameBlockIds[frameId];
+    if (dirtyFrames[frameId])
+    {
+        storage.writeBlock(victimBlockId, frames[frameId]);
+        lastAccessTime += recordPhysicalWrite(victimBlockId);
+        dirtyFrames[frameId] = false;
+    }
+    pageTable.erase(victimBlockId);
+    frameBlockIds[frameId] = -1;
+    prefetchedFrames[frameId] = false;
+    numEvictions++;
+}
+
+/**
+ * @brief Account for a fetch that had to read the block from disk.
+ *
+ * @return modelled access time in ms
+ */
+double BufferPool::recordPhysicalRead(int64_t blockId)
+{
+    ioStats.logicalReads++;
+    ioStats.physicalReads++;
+    ioStats.bytesRead += Block::BLOCK_SIZE;
+    return storage.simulateBlockAccessTime(blockId, ioStats);
+}
+
+/**
+ * @brief Account for a dirty block written back to disk.
+ *
+ * @return modelled access time in ms
+ */
+double BufferPool::recordPhysicalWrite(int64_t blockId)
+{
+    ioStats.physicalWrites++;
+    ioStats.bytesWritten += Block::BLOCK_SIZE;
+    return storage.simulateBlockAccessTime(blockId, ioStats);
+}
+
+/**
+ * @brief Drop the block held by an unpinned frame without writing it back, and return the frame to the free list.
+ */
+void BufferPool::releaseFrame(int frameId)
+{
+    leaveScanRing(frameId);
+    replacementPolicy->remove(frameId);
+    pageTable.erase(frameBlockIds[frameId]);
+    frameBlockIds[frameId] = -1;
+    dirtyFrames[frameId] = false;
+    prefetchedFrames[frameId] = false;
+    freeFrames.push_back(frameId);
+}
+
+/**
+ * @brief Take the frame out of the scan ring, if it is in it. The frame keeps its block.
+ */
+void BufferPool::leaveScanRing(int frameId)
+{
+    int slot = scanRingSlots[frameId];
+    if (slot != -1)
+    {
+        scanRing[slot] = -1;
+        scanRingSlots[frameId] = -1;
+    }
+}
+
+/**
+ * @brief Follow the run of consecutive block IDs being fetched. Once the run is long enough, the blocks
+ * after blockId are read ahead in one batch, unless they were already read ahead earlier. Fetching the
+ * last block again, e.g. to pin it for writing after reading it, neither extends nor breaks the run.
+ */
+void BufferPool::readAheadIfSequential(int64_t blockId, AccessStrategy strategy)
+{
+    if (blockId == lastFetchedBlockId)
+    {
+        return;
+    }
+    sequentialRunLength = blockId == lastFetchedBlockId + 1 ? sequentialRunLength + 1 : 1;
+    lastFetchedBlockId = blockId;
+    if (sequentialRunLength < SEQUENTIAL_RUN_THRESHOLD || pageTable.count(blockId + 1) > 0)
+    {
+        return;
+    }
+
+    // A scan reads ahead into its ring, which must keep room for the blocks still being used
+    int numBlocks = strategy == AccessStrategy::Scan ? std::min<int>(READ_AHEAD_BLOCKS, scanRing.size() / 2) : READ_AHEAD_BLOCKS;
+    std::vector<int64_t> nextBlockIds;
+    for (int i = 1; i <= numBlocks; i++)
+    {
+        nextBlockIds.push_back(blockId + i);
+    }
+    prefetchBlocks(nextBlockIds, strategy);
+}
+
+/**
+ * @brief Return the frame holding the block, reading it from disk on a miss. Sets lastAccessTime.
+ *
+ * @return frameId
+ */
+int BufferPool::fetchFrame(int64_t blockId, AccessStrategy strategy)
+{
+    auto it = pageTable.find(blockId);
+    if (it != pageTable.end())
+    {
+        int frameId = it->second;
+        if (prefetchedFrames[frameId])
+        {
+            // The block was read ahead, but it still came from disk
+            prefetchedFrames[frameId] = false;
+            lastAccessTime = recordPhysicalRead(blockId);
+        }
+        else
+        {
+            ioStats.logicalReads++;
+            ioStats.cacheTime += averageCacheAccessTime;
+            lastAccessTime = averageCacheAccessTime;
+        }
+        if (strategy == AccessStrategy::Normal)
+        {
+            // A block loaded by a scan and then used by another query is worth caching
+            leaveScanRing(frameId);
+            replacementPolicy->recordAccess(frameId);
+        }
+        return frameId;
+    }
+
+    if (!storage.hasBlock(blockId))
+    {
+        throw std::runtime_error("Block not found");
+    }
+    lastAccessTime = 0;
+    int frameId = strategy == AccessStrategy::Scan ? allocateScanFrame() : allocateFrame();
+    storage.readBlock(blockId, frames[frameId]); // Read straight into the frame
+    frameBlockIds[frameId] = blockId;
+    pageTable[blockId] = frameId;
+    lastAccessTime += recordPhysicalRead(blockId);
+    if (strategy == AccessStrategy::Normal)
+    {
+        replacementPolicy->recordAccess(frameId);
+    }
+    return frameId;
+}
+
+void BufferPool::pinFrame(int frameId)
+{
+    if (pinCounts[frameId]++ == 0)
+    {
+        replacementPolicy->setEvictable(frameId, false);
+    }
+}
+
+void BufferPool::unpinFrame(int frameId)
+{
+    if (--pinCounts[frameId] == 0)
+    {
+        replacementPolicy->setEvictable(frameId, true);
+    }
+}
+
+ReadPageGuard BufferPool::fetchPageRead(int64_t blockId, AccessStrategy strategy)
+{
+    readAheadIfSequential(blockId, strategy);
+    if (pageTable.find(blockId) == pageTable.end())
+    {
+        const Block *mappedBlock = storage.getMappedBlock(blockId);
+        if (mappedBlock != nullptr)
+        {
+            // Served from the OS page cache through the mapping, no frame is needed
+            lastAccessTime = recordPhysicalRead(blockId);
+            return ReadPageGuard(nullptr, -1, blockId, mappedBlock);
+        }
+    }
+
+    int frameId = fetchFrame(blockId, strategy);
+    pinFrame(frameId);
+    return ReadPageGuard(this, frameId, blockId, &frames[frameId]);
+}
+
+WritePageGuard BufferPool::fetchPageWrite(int64_t blockId, AccessStrategy strategy)
+{
+    readAheadIfSequential(blockId, strategy);
+    int frameId = fetchFrame(blockId, strategy);
+    pinFrame(frameId);
+    dirtyFrames[frameId] = true;
+    return WritePageGuard(this, frameId, blockId);
+}
+
+int64_t BufferPool::createBlock(BlockLayout layout)
+{
+    // A new block is empty, so it can be placed in a frame without reading it from disk
+    int64_t blockId = storage.createBlock();
+    lastAccessTime = 0;
+    int frameId = allocateFrame();
+    frames[frameId] = Block(layout);
+    frameBlockIds[frameId] = blockId;
+    dirtyFrames[frameId] = layout != BlockLayout::Row; // The storage starts every block as an empty row page
+    pageTable[blockId] = frameId;
+    replacementPolicy->recordAccess(frameId);
+    return blockId;
+}
+
+void BufferPool::deleteBlock(int64_t blockId)
+{
+    auto it = pageTable.find(blockId);
+    if (it != pageTable.end())
+    {
+        // The block is gone, so a dirty frame does not need to be written back
+        int frameId = it->second;
+        if (pinCounts[frameId] > 0)
+        {
+            throw std::runtime_error("Cannot delete a pinned block");
+        }
+        releaseFrame(frameId);
+    }
+    storage.deleteBlock(blockId);
+}
+
+void BufferPool::flushAll()
+{
+    for (int frameId = 0; frameId < (int)frames.size(); frameId++)
+    {
+        if (dirtyFrames[frameId])
+        {
+            storage.writeBlock(frameBlockIds[frameId], frames[frameId]);
+            recordPhysicalWrite(frameBlockIds[frameId]);
+            dirtyFrames[frameId] = false;
+        }
+    }
+}
+
+void BufferPool::prefetchBlocks(const std::vector<int64_t> &blockIds, AccessStrategy strategy)
+{
+    if (storage.getStorageMode() != StorageMode::File)
+    {
+        return; // In memory and through the mapping, blocks are read without waiting on the disk
+    }
+
+    // Claim a frame for every block that is not cached yet. The frames are not tracked by the
+    // replacement policy until their read completes, so the batch cannot evict its own frames.
+    // Scan frames come from the scan ring and are never tracked.
+    int poolSize = strategy == AccessStrategy::Scan ? scanRing.size() : frames.size();
+    int maxBatchSize = std::max<int>(1, poolSize / 2);
+    std::vector<int64_t> batchBlockIds;
+    std::vector<int> batchFrameIds;
+    std::vector<Block *> destinations;
+    std::vector<bool> completed;
+    try
+    {
+        for (int64_t blockId : blockIds)
+        {
+            if ((int)batchBlockIds.size() >= maxBatchSize)
+            {
+                break;
+            }
+            if (pageTable.count(blockId) > 0 || !storage.hasBlock(blockId))
+            {
+                continue;
+            }
+            int frameId = strategy == AccessStrategy::Scan ? allocateScanFrame() : allocateFrame();
+            frameBlockIds[frameId] = blockId;
+            pageTable[blockId] = frameId;
+            batchBlockIds.push_back(blockId);
+            batchFrameIds.push_back(frameId);
+            destinations.push_back(&frames[frameId]);
+        }
+
+        completed.assign(batchBlockIds.size(), false);
+        storage.readBlocks(batchBlockIds, destinations, [&](int i)
+                               {
+                                   int frameId = batchFrameIds[i];
+                                   prefetchedFrames[frameId] = true;
+                                   if (strategy == AccessStrategy::Normal)
+                                   {
+                                       replacementPolicy->recordAccess(frameId);
+                                   }
+                                   completed[i] = true;
+                                   numPrefetches++; });
+    }
+    catch (std::runtime_error &e)
+    {
+        // Give back the frames whose block was not read
+        for (int i = 0; i < (int)batchFrameIds.size(); i++)
+        {
+            if (i >= (int)completed.size() || !completed[i])
+            {
+                releaseFrame(batchFrameIds[i]);
+            }
+        }
+        throw;
+    }
+}
+
+void BufferPool::releaseScanRing()
+{
+    for (int slot = 0; slot < (int)scanRing.size(); slot++)
+    {
+        int frameId = scanRing[slot];
+        if (frameId == -1)
+        {
+            continue;
+        }
+        if (pinCounts[frameId] > 0)
+        {
+            // Still in use, so it becomes an ordinary frame
+            leaveScanRing(frameId);
+            replacementPolicy->recordAccess(frameId);
+            continue;
+        }
+        if (dirtyFrames[frameId])
+        {
+            storage.writeBlock(frameBlockIds[frameId], frames[frameId]);
+            recordPhysicalWrite(frameBlockIds[frameId]);
+        }
+        releaseFrame(frameId);
+    }
+    scanRingHand = 0;
+}
+
+double BufferPool::getHitRate() const
+{
+    return ioStats.logicalReads == 0 ? 0 : (double)ioStats.getCacheHits() / ioStats.logicalReads;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file buffer_pool.h
+ * @brief Defines the BufferPool class, a bounded cache of blocks in front of the DiskManager.
+ *
+ * The pool works on any BlockStorage, a single DiskManager or a StripedDiskManager over several of them.
+ *
+ * The buffer pool holds a fixed number of frames, each able to hold one block. Reads that find
+ * their block in a frame are cache hits and never reach the DiskManager. Reads that miss load the
+ * block from the DiskManager into a free frame, evicting another block with the configured
+ * ReplacementPolicy if every frame is in use. Writes only update the frame and mark it dirty,
+ * dirty frames are written back to the DiskManager when they are evicted or flushed.
+ *
+ * Since every Database read and write goes through the buffer pool, the hit rate reported here
+ * is the one produced by the actual access pattern of the B+ tree and linear scan workloads.
+ *
+ * Blocks are accessed in place through page guards instead of being copied out of the pool.
+ * A ReadPageGuard or WritePageGuard pins the frame for as long as the guard lives, so the frame
+ * cannot be evicted while the caller holds a reference to its block, and unpins it when the guard
+ * goes out of scope. A WritePageGuard also marks the frame dirty.
+ *
+ * When the DiskManager memory-maps its data file, the OS page cache already caches the blocks, so
+ * reads of blocks that are not in the pool are served from the mapping instead of taking a frame.
+ * Only written blocks occupy frames in that mode.
+ *
+ * prefetchBlocks() loads a batch of blocks into frames ahead of the fetches that will use them, so
+ * a scan or an index lookup can keep many disk reads in flight instead of waiting for one block at
+ * a time. The first fetch of a prefetched block is still counted as a miss, since the block had to
+ * come from disk, only the waiting is overlapped. The pool also notices runs of consecutive block
+ * IDs and then reads the next blocks ahead on its own, so sequential readers get this for free.
+ *
+ * Scans fetch with AccessStrategy::Scan. Their misses are loaded into a small private ring of frames
+ * that is recycled as the scan moves on, instead of into frames taken from the replacement policy,
+ * and their hits do not count as accesses. A full scan therefore leaves the pages cached by B+ tree
+ * lookups in place. releaseScanRing() hands the ring frames back once the scan is done.
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "block.h"
+#include "block_storage.h"
+#include "io_stats.h"
+#include "replacement_policy.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class BufferPool;
+
+/**
+ * How a fetch uses the buffer pool.
+ * Normal fetches compete for frames through the replacement policy.
+ * Scan fetches load their misses into the scan ring, so they never evict other cached pages.
+ */
+enum class AccessStrategy
+{
+    Normal,
+    Scan
+};
+
+/**
+ * Pins one frame of the BufferPool for reading. Move-only, the frame is unpinned on destruction or release().
+ * In MemoryMapped mode, a block that is not in the pool is served straight from the mapping, without a frame.
+ */
+class ReadPageGuard
+{
+private:
+    BufferPool *bufferPool; // nullptr if no frame is pinned
+    int frameId;
+    int64_t blockId;
+    const Block *block;
+
+public:
+    ReadPageGuard() : bufferPool(nullptr), frameId(-1), blockId(-1), block(nullptr) {}
+    ReadPageGuard(BufferPool *bufferPool, int frameId, int64_t blockId, const Block *block)
+        : bufferPool(bufferPool), frameId(frameId), blockId(blockId), block(block) {}
+    ReadPageGuard(ReadPageGuard &&other) noexcept;
+    ReadPageGuard &operator=(ReadPageGuard &&other) noexcept;
+    ~ReadPageGuard() { release(); }
+
+    ReadPageGuard(const ReadPageGuard &) = delete;
+    ReadPageGuard &operator=(const ReadPageGuard &) = delete;
+
+    const Block &getBlock() const { return *block; };
+    int64_t getBlockId() const { return blockId; };
+    void release();
+};
+
+/**
+ * Pins one frame of the BufferPool for writing and marks it dirty. Move-only, the frame is unpinned on destruction or release().
+ */
+class WritePageGuard
+{
+private:
+    BufferPool *bufferPool;
+    int frameId;
+    int64_t blockId;
+
+public:
+    WritePageGuard() : bufferPool(nullptr), frameId(-1), blockId(-1) {}
+    WritePageGuard(BufferPool *bufferPool, int frameId, int64_t blockId) : bufferPool(bufferPool), frameId(frameId), blockId(blockId) {}
+    WritePageGuard(WritePageGuard &&other) noexcept;
+    WritePageGuard &operator=(WritePageGuard &&other) noexcept;
+    ~WritePageGuard() { release(); }
+
+    WritePageGuard(const WritePageGuard &) = delete;
+    WritePageGuard &operator=(const WritePageGuard &) = delete;
+
+    Block &getBlock();
+    int64_t getBlockId() const { return blockId; };
+    void release();
+};
+
+class BufferPool
+{
+    friend class ReadPageGuard;
+    friend class WritePageGuard;
+
+private:
+    BlockStorage &storage; // DiskManager or StripedDiskManager
+
+    std::vector<Block> frames;                  // Cached copies of blocks
+    std::vector<int64_t> frameBlockIds;         // Block ID held by each frame, -1 if the frame is free
+    std::vector<bool> dirtyFrames;              // Frames modified since they were read from disk
+    std::vector<bool> prefetchedFrames;         // Frames read by prefetchBlocks() and not fetched since
+    std::vector<int> pinCounts;                 // Number of live page guards per frame, pinned frames are never evicted
+    std::unordered_map<int64_t, int> pageTable; // Maps block IDs to the frame holding them
+    std::vector<int> freeFrames;                // Frames not holding any block
+    std::unique_ptr<ReplacementPolicy> replacementPolicy;
+
+    double averageCacheAccessTime; // Access time of a block found in the buffer pool in ms
+    double lastAccessTime;         // Modelled time of the most recent read or write in ms
+
+    static constexpr int SCAN_RING_FRAMES = 64;        // Frames of the scan ring, at most a quarter of the pool
+    static constexpr int READ_AHEAD_BLOCKS = 32;       // Blocks read ahead once a sequential run is detected
+    static constexpr int SEQUENTIAL_RUN_THRESHOLD = 4; // Consecutive block IDs fetched before the pool reads ahead
+    std::vector<int> scanRing;                         // Frames of the scan ring, -1 for a slot without a frame yet
+    std::vector<int> scanRingSlots;                    // Slot of each frame in the scan ring, -1 for frames outside it
+    int scanRingHand;                                  // Next slot of the scan ring to recycle
+    int64_t lastFetchedBlockId;
+    int sequentialRunLength; // Number of consecutive block IDs fetched up to lastFetchedBlockId
+
+    // Statistics
+    IOStats ioStats; // Logical and physical I/O since the buffer pool was created
+    long long numEvictions;
+    long long numPrefetches;
+
+    int fetchFrame(int64_t blockId, AccessStrategy strategy);
+    int allocateFrame();
+    int allocateScanFrame();
+    void evictFrameContents(int frameId);
+    void releaseFrame(int frameId);
+    void leaveScanRing(int frameId);
+    void readAheadIfSequential(int64_t blockId, AccessStrategy strategy);
+    double recordPhysicalRead(int64_t blockId);
+    double recordPhysicalWrite(int64_t blockId);
+    void pinFrame(int frameId);
+    void unpinFrame(int frameId);
+
+public:
+    BufferPool(BlockStorage &storage, int numFrames, ReplacementPolicyType policyType = ReplacementPolicyType::Clock, int lruK = 2);
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    ReadPageGuard fetchPageRead(int64_t blockId, AccessStrategy strategy = AccessStrategy::Normal);
+    WritePageGuard fetchPageWrite(int64_t blockId, AccessStrategy strategy = AccessStrategy::Normal);
+    int64_t createBlock(BlockLayout layout = BlockLayout::Row);
+    void deleteBlock(int64_t blockId);
+    void flushAll();
+
+    // Read the blocks that are not cached yet in one batch, with the reads in flight at the same time.
+    // At most half of the frames (of the scan ring for AccessStrategy::Scan) are filled, so a batch never
+    // evicts the blocks it just read. Only File mode reads ahead.
+    void prefetchBlocks(const std::vector<int64_t> &blockIds, AccessStrategy strategy = AccessStrategy::Normal);
+    // Drop the blocks of the scan ring, writing back dirty ones, and return its frames to the pool
+    void releaseScanRing();
+
+    // Modelled time of the most recent page fetch, cache access time on a hit and disk access time on a miss
+    double getLastAccessTime() const { return lastAccessTime; };
+
+    int getNumFrames() const { return frames.size(); };
+    const IOStats &getIOStats() const { return ioStats; };
+    long long getNumHits() const { return ioStats.getCacheHits(); };
+    long long getNumMisses() const { return ioStats.physicalReads; };
+    long long getNumEvictions() const { return numEvictions; };
+    long long getNumWriteBacks() const { return ioStats.physicalWrites; };
+    long long getNumPrefetches() const { return numPrefetches; };
+    double getHitRate() const;
+};
+
+#endif // BUFFER_POOL_H
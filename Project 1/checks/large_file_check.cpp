@@ -0,0 +1,174 @@
+/**
+ * @file large_file_check.cpp
+ * @brief Checks that data files larger than 4 GiB can be written, reopened and queried.
+ *
+ * For the File and MemoryMapped storage modes, a data file is created with one block at the start and
+ * one block whose byte offset is past 2^32. The file is then reopened through a Database, which rebuilds
+ * the block directory and the B+ tree from it, and the records of both blocks are queried with the
+ * B+ tree and with a linear scan. Both must return the expected records.
+ *
+ * Build and run from "Project 1", with the source files of the build line in main.cpp except main.cpp:
+ *
+ * g++ -std=c++17 -I. checks/large_file_check.cpp b_plus_tree.cpp tree_helper.cpp block.cpp database.cpp record.cpp disk_manager.cpp buffer_pool.cpp replacement_policy.cpp free_space_map.cpp async_reader.cpp io_stats.cpp request_scheduler.cpp striped_disk_manager.cpp block_codec.cpp tiered_block_arena.cpp crc32c.cpp column_segment.cpp predicate_kernels.cpp node_search.cpp node_arena.cpp -o large_file_check.exe
+ * ./large_file_check.exe [directory for the data files, default .]
+ *
+ * The data files are sparse, so they take a few blocks of real disk space, and they are deleted at the end.
+ * Exits with status 1 on the first failed check.
+ */
+
+#include "database.h"
+#include "disk_manager.h"
+#include "block.h"
+#include "record.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A block whose page starts past 2^32 bytes into the data file
+static const int64_t FAR_BLOCK_ID = (int64_t(1) << 32) / Block::BLOCK_SIZE + 1000;
+
+// Room for the far block, and for the chunks the mapped data file grows by
+static const int64_t DISK_SIZE = (FAR_BLOCK_ID + 4096) * Block::BLOCK_SIZE;
+
+// numVotes of the records stored in the first block only, in the far block only, and in both
+static const int NEAR_VOTES = 11;
+static const int FAR_VOTES = 4242;
+static const int SHARED_VOTES = 500;
+
+static void check(bool condition, const std::string &message)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * @brief Fill a block with records: the first half get uniqueVotes, the rest SHARED_VOTES.
+ * The tconsts are tt<prefix><slot>, e.g. tt1000003 for slot 3 with prefix 1, so they differ between blocks.
+ */
+static Block makeBlock(int prefix, int uniqueVotes)
+{
+    Block block;
+    for (int i = 0; i < Block::BLOCK_CAPACITY; i++)
+    {
+        int numVotes = i < Block::BLOCK_CAPACITY / 2 ? uniqueVotes : SHARED_VOTES;
+        std::string tconst = "tt" + std::to_string(prefix * 1000000 + i);
+        block.insertRecord(Record(tconst, 5.0f + i / 10.0f, numVotes), block.getFreeIndex());
+    }
+    return block;
+}
+
+static int countVotes(int numVotes, int low, int high)
+{
+    return numVotes >= low && numVotes <= high ? 1 : 0;
+}
+
+// Number of records of both blocks with low <= numVotes <= high
+static int expectedCount(int low, int high)
+{
+    int count = 0;
+    for (int i = 0; i < Block::BLOCK_CAPACITY; i++)
+    {
+        bool uniqueHalf = i < Block::BLOCK_CAPACITY / 2;
+        count += uniqueHalf ? countVotes(NEAR_VOTES, low, high) + countVotes(FAR_VOTES, low, high) : 2 * countVotes(SHARED_VOTES, low, high);
+    }
+    return count;
+}
+
+/**
+ * @brief Both results hold the same records, compared by tconst, numVotes and averageRating.
+ */
+static bool sameRecords(std::vector<Record> a, std::vector<Record> b)
+{
+    auto byTconst = [](const Record &x, const Record &y)
+    { return x.getTconst() < y.getTconst(); };
+    std::sort(a.begin(), a.end(), byTconst);
+    std::sort(b.begin(), b.end(), byTconst);
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].getTconst() != b[i].getTconst() || a[i].getNumVotes() != b[i].getNumVotes() ||
+            a[i].getAverageRating() != b[i].getAverageRating())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void checkStorageMode(StorageMode storageMode, const std::string &modeName, const std::string &dataFilePath)
+{
+    std::remove(dataFilePath.c_str());
+    std::remove((dataFilePath + ".fsm").c_str());
+
+    // Write the two blocks straight through a DiskManager, so the far block is created without the ones before it
+    {
+        DiskManager disk(DISK_SIZE, storageMode, dataFilePath);
+        int64_t nearBlockId = disk.createBlock();
+        disk.writeBlock(nearBlockId, makeBlock(1, NEAR_VOTES));
+        disk.createBlockWithId(FAR_BLOCK_ID);
+        disk.writeBlock(FAR_BLOCK_ID, makeBlock(2, FAR_VOTES));
+    }
+
+    // Reopen the file, which rebuilds the block directory and bulk loads the B+ tree from the pages
+    DatabaseConfig config;
+    config.storageMode = storageMode;
+    config.dataFilePath = dataFilePath;
+    config.openExisting = true;
+    Database db(DISK_SIZE, config);
+    check(db.getStorage().getNumBlocksUsed() == 2, modeName + ": expected 2 blocks after reopening");
+    check(db.getStorage().hasBlock(FAR_BLOCK_ID), modeName + ": the block past 2^32 bytes was not found after reopening");
+
+    // The queries report their I/O on std::cout, which is not part of the check
+    std::ostringstream queryLog;
+    std::streambuf *coutBuffer = std::cout.rdbuf(queryLog.rdbuf());
+    std::vector<std::vector<Record>> results;
+    for (int numVotes : {NEAR_VOTES, FAR_VOTES, SHARED_VOTES})
+    {
+        results.push_back(db.retrieveRecordByBPTree(numVotes).records);
+        results.push_back(db.retrieveRecordByLinearScan(numVotes).records);
+    }
+    results.push_back(db.retrieveRangeRecordsByBPTree(0, FAR_VOTES).records);
+    results.push_back(db.retrieveRangeRecordsByLinearScan(0, FAR_VOTES).records);
+    std::cout.rdbuf(coutBuffer);
+
+    const int queries[][2] = {{NEAR_VOTES, NEAR_VOTES}, {FAR_VOTES, FAR_VOTES}, {SHARED_VOTES, SHARED_VOTES}, {0, FAR_VOTES}};
+    for (int q = 0; q < 4; q++)
+    {
+        std::string query = std::to_string(queries[q][0]) + " <= numVotes <= " + std::to_string(queries[q][1]);
+        check((int)results[2 * q].size() == expectedCount(queries[q][0], queries[q][1]),
+              modeName + ": B+ tree returned " + std::to_string(results[2 * q].size()) + " records for " + query);
+        check(sameRecords(results[2 * q], results[2 * q + 1]),
+              modeName + ": B+ tree and linear scan returned different records for " + query);
+    }
+    std::cout << modeName << ": block " << FAR_BLOCK_ID << " at byte offset " << FAR_BLOCK_ID * Block::BLOCK_SIZE
+              << " reopened, B+ tree and linear scan results match" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string directory = argc > 1 ? argv[1] : ".";
+    std::string dataFilePath = directory + "/large_file_check.dat";
+    int status = 0;
+    try
+    {
+        checkStorageMode(StorageMode::File, "File", dataFilePath);
+        checkStorageMode(StorageMode::MemoryMapped, "MemoryMapped", dataFilePath);
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Large file check failed: " << e.what() << std::endl;
+        status = 1;
+    }
+    std::remove(dataFilePath.c_str());
+    std::remove((dataFilePath + ".fsm").c_str());
+    return status;
+}
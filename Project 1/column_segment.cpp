@@ -0,0 +1,296 @@
+#include "column_segment.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// Columns in the order they are stored in the page
+static const int NUM_VOTES_COLUMN = 0;
+static const int RATING_COLUMN = 1;
+static const int TCONST_COLUMN = 2;
+static const int NUM_COLUMNS = 3;
+
+// Header fields
+static const int NUM_RECORDS_POSITION = 0;
+static const int FLAGS_POSITION = 2;
+static const int COLUMNS_POSITION = 3; // Reference (uint32) and bit width (uint8) of every column
+static const int COLUMN_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t);
+
+// Flags of the columns that could not be encoded and are stored raw
+static const uint8_t RAW_RATING_FLAG = 1;
+static const uint8_t RAW_TCONST_FLAG = 2;
+
+static const int RAW_TCONST_SIZE = 10; // Characters of a tconst, as in Record::serialize()
+static const int MAX_RECORDS = 65535;  // Largest count the header can hold
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Value codes ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+// Rating in tenths, if converting it back gives exactly the same float
+static bool encodeRating(float averageRating, uint32_t &code)
+{
+    if (!(averageRating >= 0 && averageRating <= 100000))
+    {
+        return false;
+    }
+    long tenths = std::lround(averageRating * 10.0);
+    code = tenths;
+    return (float)(tenths / 10.0) == averageRating;
+}
+
+// "tt" and 7 or 8 digits as number * 2 + (1 if there are 8 digits)
+static bool encodeTconst(const Record &record, uint32_t &code)
+{
+    std::string tconst = record.getTconst();
+    if (tconst.size() != RAW_TCONST_SIZE || tconst[0] != 't' || tconst[1] != 't')
+    {
+        return false;
+    }
+    bool eightDigits = tconst[9] != ' ';
+    int numDigits = eightDigits ? 8 : 7;
+    uint32_t number = 0;
+    for (int i = 2; i < 2 + numDigits; i++)
+    {
+        if (tconst[i] < '0' || tconst[i] > '9')
+        {
+            return false;
+        }
+        number = number * 10 + (tconst[i] - '0');
+    }
+    code = number * 2 + (eightDigits ? 1 : 0);
+    return true;
+}
+
+static std::string decodeTconst(uint32_t code)
+{
+    char tconst[16];
+    std::snprintf(tconst, sizeof(tconst), "tt%0*u", code & 1 ? 8 : 7, code >> 1);
+    return tconst;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Bit packing ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+static int bitsNeeded(uint32_t range)
+{
+    return range == 0 ? 0 : 32 - __builtin_clz(range);
+}
+
+static int packedSize(int numValues, int bitWidth)
+{
+    return ((int64_t)numValues * bitWidth + 7) / 8;
+}
+
+// Store the differences of the values to reference in bitWidth bits each, lowest bits first
+static void packColumn(const std::vector<uint32_t> &values, uint32_t reference, int bitWidth, uint8_t *dest)
+{
+    uint64_t buffer = 0;
+    int numBits = 0;
+    for (uint32_t value : values)
+    {
+        buffer |= (uint64_t)(value - reference) << numBits;
+        numBits += bitWidth;
+        while (numBits >= 8)
+        {
+            *dest++ = buffer;
+            buffer >>= 8;
+            numBits -= 8;
+        }
+    }
+    if (numBits > 0)
+    {
+        *dest = buffer;
+    }
+}
+
+static void unpackColumn(const uint8_t *src, int numValues, uint32_t reference, int bitWidth, uint32_t *values)
+{
+    uint64_t mask = (1ULL << bitWidth) - 1;
+    uint64_t buffer = 0;
+    int numBits = 0;
+    for (int i = 0; i < numValues; i++)
+    {
+        while (numBits < bitWidth)
+        {
+            buffer |= (uint64_t)*src++ << numBits;
+            numBits += 8;
+        }
+        values[i] = reference + (uint32_t)(buffer & mask);
+        buffer >>= bitWidth;
+        numBits -= bitWidth;
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Page layout ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+static uint32_t readReference(const uint8_t *page, int column)
+{
+    uint32_t reference;
+    std::memcpy(&reference, page + COLUMNS_POSITION + column * COLUMN_HEADER_SIZE, sizeof(reference));
+    return reference;
+}
+
+static int readBitWidth(const uint8_t *page, int column)
+{
+    return page[COLUMNS_POSITION + column * COLUMN_HEADER_SIZE + sizeof(uint32_t)];
+}
+
+static int columnSize(int numRecords, int bitWidth, bool raw, int column)
+{
+    return column == TCONST_COLUMN && raw ? numRecords * RAW_TCONST_SIZE : packedSize(numRecords, bitWidth);
+}
+
+// Start of the column data, the columns follow each other without gaps
+static const uint8_t *columnData(const uint8_t *page, int column)
+{
+    int numRecords = ColumnSegment::getNumRecords(page);
+    bool rawTconst = page[FLAGS_POSITION] & RAW_TCONST_FLAG;
+    int position = ColumnSegment::HEADER_SIZE;
+    for (int previous = 0; previous < column; previous++)
+    {
+        position += columnSize(numRecords, readBitWidth(page, previous), rawTconst, previous);
+    }
+    return page + position;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ ColumnSegment ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+int ColumnSegment::encode(const Record *records, int numRecords, uint8_t *page)
+{
+    // Grow the segment one record at a time, while the columns still fit in the page
+    uint32_t minValues[NUM_COLUMNS] = {UINT32_MAX, UINT32_MAX, UINT32_MAX};
+    uint32_t maxValues[NUM_COLUMNS] = {0, 0, 0};
+    uint8_t flags = 0;
+    std::vector<uint32_t> values[NUM_COLUMNS];
+    int numEncoded = 0;
+    for (; numEncoded < numRecords && numEncoded < MAX_RECORDS; numEncoded++)
+    {
+        const Record &record = records[numEncoded];
+        uint32_t codes[NUM_COLUMNS] = {(uint32_t)record.getNumVotes(), 0, 0};
+        uint8_t newFlags = flags;
+        if (!encodeRating(record.getAverageRating(), codes[RATING_COLUMN]))
+        {
+            newFlags |= RAW_RATING_FLAG;
+        }
+        if (!encodeTconst(record, codes[TCONST_COLUMN]))
+        {
+            newFlags |= RAW_TCONST_FLAG;
+        }
+
+        int size = HEADER_SIZE;
+        for (int column = 0; column < NUM_COLUMNS; column++)
+        {
+            int bitWidth = bitsNeeded(std::max(maxValues[column], codes[column]) - std::min(minValues[column], codes[column]));
+            if (column == RATING_COLUMN && (newFlags & RAW_RATING_FLAG))
+            {
+                bitWidth = 32; // Float bits, with a reference of 0
+            }
+            size += columnSize(numEncoded + 1, bitWidth, newFlags & RAW_TCONST_FLAG, column);
+        }
+        if (size > SEGMENT_SIZE)
+        {
+            break;
+        }
+
+        flags = newFlags;
+        for (int column = 0; column < NUM_COLUMNS; column++)
+        {
+            minValues[column] = std::min(minValues[column], codes[column]);
+            maxValues[column] = std::max(maxValues[column], codes[column]);
+            values[column].push_back(codes[column]);
+        }
+    }
+
+    std::memset(page, 0, SEGMENT_SIZE);
+    uint16_t count = numEncoded;
+    std::memcpy(page + NUM_RECORDS_POSITION, &count, sizeof(count));
+    page[FLAGS_POSITION] = flags;
+    uint8_t *dest = page + HEADER_SIZE;
+    for (int column = 0; column < NUM_COLUMNS; column++)
+    {
+        uint32_t reference = numEncoded > 0 ? minValues[column] : 0;
+        int bitWidth = bitsNeeded(maxValues[column] - reference);
+        if (column == RATING_COLUMN && (flags & RAW_RATING_FLAG))
+        {
+            reference = 0;
+            bitWidth = 32;
+            for (int i = 0; i < numEncoded; i++)
+            {
+                float averageRating = records[i].getAverageRating();
+                std::memcpy(&values[column][i], &averageRating, sizeof(float));
+            }
+        }
+        uint8_t *columnHeader = page + COLUMNS_POSITION + column * COLUMN_HEADER_SIZE;
+        std::memcpy(columnHeader, &reference, sizeof(reference));
+        columnHeader[sizeof(uint32_t)] = bitWidth;
+
+        if (column == TCONST_COLUMN && (flags & RAW_TCONST_FLAG))
+        {
+            for (int i = 0; i < numEncoded; i++)
+            {
+                std::memcpy(dest + i * RAW_TCONST_SIZE, records[i].getTconst().data(), RAW_TCONST_SIZE);
+            }
+        }
+        else
+        {
+            packColumn(values[column], reference, bitWidth, dest);
+        }
+        dest += columnSize(numEncoded, bitWidth, flags & RAW_TCONST_FLAG, column);
+    }
+    return numEncoded;
+}
+
+int ColumnSegment::getNumRecords(const uint8_t *page)
+{
+    uint16_t count;
+    std::memcpy(&count, page + NUM_RECORDS_POSITION, sizeof(count));
+    return count;
+}
+
+void ColumnSegment::decodeNumVotes(const uint8_t *page, uint32_t *numVotes)
+{
+    unpackColumn(columnData(page, NUM_VOTES_COLUMN), getNumRecords(page), readReference(page, NUM_VOTES_COLUMN),
+                 readBitWidth(page, NUM_VOTES_COLUMN), numVotes);
+}
+
+void ColumnSegment::decodeRecords(const uint8_t *page, std::vector<Record> &records)
+{
+    int numRecords = getNumRecords(page);
+    uint8_t flags = page[FLAGS_POSITION];
+    std::vector<uint32_t> values[NUM_COLUMNS];
+    for (int column = 0; column < NUM_COLUMNS; column++)
+    {
+        if (column == TCONST_COLUMN && (flags & RAW_TCONST_FLAG))
+        {
+            continue;
+        }
+        values[column].resize(numRecords);
+        unpackColumn(columnData(page, column), numRecords, readReference(page, column), readBitWidth(page, column), values[column].data());
+    }
+
+    const uint8_t *rawTconsts = columnData(page, TCONST_COLUMN);
+    records.reserve(records.size() + numRecords);
+    for (int i = 0; i < numRecords; i++)
+    {
+        float averageRating;
+        if (flags & RAW_RATING_FLAG)
+        {
+            std::memcpy(&averageRating, &values[RATING_COLUMN][i], sizeof(float));
+        }
+        else
+        {
+            averageRating = (float)(values[RATING_COLUMN][i] / 10.0);
+        }
+        std::string tconst = flags & RAW_TCONST_FLAG
+                                 ? std::string(reinterpret_cast<const char *>(rawTconsts + i * RAW_TCONST_SIZE), RAW_TCONST_SIZE)
+                                 : decodeTconst(values[TCONST_COLUMN][i]);
+        records.emplace_back(tconst, averageRating, values[NUM_VOTES_COLUMN][i]);
+    }
+}
@@ -0,0 +1,53 @@
+/**
+ * @file column_segment.h
+ * @brief Defines the ColumnSegment class, a compressed column-wise page format for records.
+ *
+ * A column segment holds a run of records in one page of SEGMENT_SIZE bytes, the size of a Block,
+ * with the values of each attribute stored together:
+ *
+ *   [ header | numVotes column | averageRating column | tconst column ]
+ *
+ * Every column is frame-of-reference encoded and bit-packed: the smallest value of the segment is
+ * stored once in the header, and every value is stored as its difference to it, in just enough bits
+ * for the largest difference.
+ *
+ * - numVotes is heavily skewed, most titles have few votes, so the differences are small in most
+ *   segments and only segments with a popular title need wide values.
+ * - averageRating has one decimal, so it is stored in fixed point as tenths (91 distinct values
+ *   between 1.0 and 10.0). Ratings that do not round-trip through tenths are stored as raw floats.
+ * - tconst is "tt" followed by 7 or 8 digits, so it is stored as the number, with one bit telling
+ *   the two lengths apart. Consecutive records of the IMDb file have close tconsts, which keeps the
+ *   differences small. Identifiers in any other form are stored as their 10 raw characters.
+ *
+ * encode() fills a page with as many records as fit. Segments are decoded a whole column at a time,
+ * so a scan decodes the numVotes column of a segment in one batch, tests it, and only decodes the
+ * records of segments that have a match.
+ */
+
+#ifndef COLUMN_SEGMENT_H
+#define COLUMN_SEGMENT_H
+
+#include "block.h"
+#include "record.h"
+#include <cstdint>
+#include <vector>
+
+class ColumnSegment
+{
+public:
+    static constexpr int SEGMENT_SIZE = Block::BLOCK_SIZE;
+    static constexpr int HEADER_SIZE = 18; // numRecords, flags, then the reference and bit width of each of the 3 columns
+
+    // Encode records, starting with the first one, into the page until it is full. Returns the number encoded
+    static int encode(const Record *records, int numRecords, uint8_t *page);
+
+    static int getNumRecords(const uint8_t *page);
+
+    // Decode the whole numVotes column of the page into numVotes, which needs room for getNumRecords() values
+    static void decodeNumVotes(const uint8_t *page, uint32_t *numVotes);
+
+    // Decode every record of the page and append them to records
+    static void decodeRecords(const uint8_t *page, std::vector<Record> &records);
+};
+
+#endif // COLUMN_SEGMENT_H
@@ -0,0 +1,119 @@
+#include "crc32c.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_HAVE_SSE42 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_HAVE_ARM_CRC 1
+#endif
+
+static const uint32_t CRC32C_POLYNOMIAL = 0x82F63B78; // Castagnoli polynomial, bit-reversed
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Table-driven fallback ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+static const std::array<uint32_t, 256> crcTable = []
+{
+    std::array<uint32_t, 256> table;
+    for (uint32_t byte = 0; byte < 256; byte++)
+    {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        }
+        table[byte] = crc;
+    }
+    return table;
+}();
+
+static uint32_t updateTable(uint32_t crc, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Hardware implementations ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+#ifdef CRC32C_HAVE_SSE42
+// Compiled for SSE4.2 on its own, so the rest of the program does not require it
+__attribute__((target("sse4.2"))) static uint32_t updateSse42(uint32_t crc, const uint8_t *data, size_t length)
+{
+    uint64_t crc64 = crc;
+    for (; length >= sizeof(uint64_t); data += sizeof(uint64_t), length -= sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+    for (; length > 0; data++, length--)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+// Runs during static initialisation, before the CPU model is set up for __builtin_cpu_supports
+static const bool hasSse42 = []
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") != 0;
+}();
+#endif
+
+#ifdef CRC32C_HAVE_ARM_CRC
+static uint32_t updateArm(uint32_t crc, const uint8_t *data, size_t length)
+{
+    for (; length >= sizeof(uint64_t); data += sizeof(uint64_t), length -= sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; length > 0; data++, length--)
+    {
+        crc = __crc32cb(crc, *data);
+    }
+    return crc;
+}
+#endif
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Crc32c ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+uint32_t Crc32c::compute(const uint8_t *data, size_t length, uint32_t crc)
+{
+    crc = ~crc;
+#if defined(CRC32C_HAVE_SSE42)
+    crc = hasSse42 ? updateSse42(crc, data, length) : updateTable(crc, data, length);
+#elif defined(CRC32C_HAVE_ARM_CRC)
+    crc = updateArm(crc, data, length);
+#else
+    crc = updateTable(crc, data, length);
+#endif
+    return ~crc;
+}
+
+const char *Crc32c::getImplementationName()
+{
+#if defined(CRC32C_HAVE_SSE42)
+    return hasSse42 ? "SSE4.2" : "table";
+#elif defined(CRC32C_HAVE_ARM_CRC)
+    return "ARMv8 CRC";
+#else
+    return "table";
+#endif
+}
@@ -0,0 +1,27 @@
+/**
+ * @file crc32c.h
+ * @brief Defines the Crc32c class, the CRC32C (Castagnoli) checksum used to detect corrupt pages.
+ *
+ * CRC32C is computed in hardware where the CPU has an instruction for it: the SSE4.2 crc32 instruction
+ * on x86-64, selected at run time since not every x86-64 CPU has it, and the ARMv8 CRC extension when
+ * the compiler targets it. Everywhere else a table-driven implementation is used. All of them produce
+ * the same checksum, so pages written on one machine verify on another.
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+class Crc32c
+{
+public:
+    // CRC32C of length bytes. Pass the CRC of the preceding bytes as crc to checksum data in several pieces
+    static uint32_t compute(const uint8_t *data, size_t length, uint32_t crc = 0);
+
+    // Name of the implementation in use, e.g. for reporting
+    static const char *getImplementationName();
+};
+
+#endif // CRC32C_H
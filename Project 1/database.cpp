@@ -3,253 +3,654 @@
 #include <iostream>
 #include <algorithm>
 #include <iomanip>
+#include <unordered_map>
 
-Database::Database(uint databaseSize) : diskManager(databaseSize)
+Database::Database(int64_t databaseSize, const DatabaseConfig &config)
+    : storage(createStorage(databaseSize, config)),
+      bufferPool(*storage, config.bufferPoolFrames, config.replacementPolicy, config.lruK),
+      freeSpaceMap(Block::BLOCK_CAPACITY), requestScheduler(*storage, config.schedulingPolicy),
+      blockLayout(config.blockLayout), indexFillFactor(config.indexFillFactor)
 {
-    this->bptree = BPTree();
+    storage->seedAccessModel(config.accessModelSeed);
+    storage->setMaxHotChunks(config.maxHotChunks);
+    if (storage->getNumBlocksUsed() > 0)
+    {
+        loadExistingRecords();
+    }
+}
+
+/**
+ * @brief A single DiskManager, or a StripedDiskManager when the config asks for more than one device.
+ */
+std::unique_ptr<BlockStorage> Database::createStorage(int64_t databaseSize, const DatabaseConfig &config)
+{
+    if (config.numDevices > 1)
+    {
+        return std::make_unique<StripedDiskManager>(databaseSize, config.numDevices, config.stripeWidth,
+                                                    config.storageMode, config.dataFilePath, config.openExisting);
+    }
+    return std::make_unique<DiskManager>(databaseSize, config.storageMode, config.dataFilePath, config.openExisting);
+}
+
+Database::~Database()
+{
+    std::string freeSpaceMapPath = getFreeSpaceMapPath();
+    if (!freeSpaceMapPath.empty())
+    {
+        try
+        {
+            freeSpaceMap.save(freeSpaceMapPath);
+        }
+        catch (std::runtime_error &e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
 }
 
-Database::~Database() {}
+std::string Database::getFreeSpaceMapPath() const
+{
+    if (storage->getStorageMode() == StorageMode::InMemory)
+    {
+        return "";
+    }
+    return storage->getDataFilePath() + ".fsm";
+}
+
+const BlockStorage &Database::getStorage()
+{
+    bufferPool.flushAll();
+    return *storage;
+}
 
 /**
- * @brief Find a free slot in Blocks, if not found, create a new block. Consumes 1 record slot in the freeBlockSlotHash.
- *
- * @return blockId
+ * @brief Sort index entries into the order of the keys in the B+ tree, records with the same key by address.
  */
-int Database::getFreeBlock()
+static void sortByKey(std::vector<RecordKeyPointerPair> &kpps)
 {
-    int blockId;
-    if (freeBlockSlotHash.empty())
+    std::sort(kpps.begin(), kpps.end(), [](const RecordKeyPointerPair &a, const RecordKeyPointerPair &b)
+              { return a.key < b.key || (a.key == b.key && a.pointer < b.pointer); });
+}
+
+/**
+ * @brief Rebuild the free slot counts and the B+ tree from the blocks of an existing data file.
+ * Only the index is rebuilt, the records themselves are read in place from the file. The free slot
+ * counts are taken from the saved free space map when there is one. Tombstoned records are left out
+ * of the index and queued again, so cleanIndex() frees their slots.
+ */
+void Database::loadExistingRecords()
+{
+    std::string freeSpaceMapPath = getFreeSpaceMapPath();
+    bool freeSpaceMapLoaded = !freeSpaceMapPath.empty() && freeSpaceMap.load(freeSpaceMapPath);
+
+    storage->adviseAccessPattern(AccessPattern::Sequential);
+    std::vector<RecordKeyPointerPair> kpps;
+    std::vector<int64_t> blockIds = storage->getAllBlockIds();
+    for (int64_t position = 0; position < (int64_t)blockIds.size(); position++)
     {
-        blockId = diskManager.createBlock();
-        freeBlockSlotHash[blockId] = diskManager.BLOCK_SIZE / sizeof(Record) - 1; // -1 to account for the record being inserted
+        int64_t blockId = blockIds[position];
+        ReadPageGuard page = bufferPool.fetchPageRead(blockId, AccessStrategy::Scan);
+        const Block &block = page.getBlock();
+        for (int i = 0; i < block.getNumSlots(); i++)
+        {
+            if (block.isRecordLive(i))
+            {
+                kpps.push_back(RecordKeyPointerPair(block.retrieveRecord(i).getNumVotes(), RecordPointer(blockId, i)));
+            }
+            else if (block.isTombstoned(i))
+            {
+                pendingIndexDeletes.push_back(RecordKeyPointerPair(block.retrieveRecord(i).getNumVotes(), RecordPointer(blockId, i)));
+            }
+        }
+        if (!freeSpaceMapLoaded)
+        {
+            freeSpaceMap.setFreeSlots(blockId, block.getNumFreeSlots());
+        }
     }
-    else
+    bufferPool.releaseScanRing();
+    storage->adviseAccessPattern(AccessPattern::Normal);
+
+    sortByKey(kpps);
+    bptree.bulkLoad(kpps, indexFillFactor);
+}
+
+/**
+ * @brief Return the I/O of the query that started when statsBefore was taken, and add it to the session stats.
+ */
+IOStats Database::endQuery(const IOStats &statsBefore)
+{
+    IOStats queryStats = bufferPool.getIOStats() - statsBefore;
+    sessionIOStats += queryStats;
+    return queryStats;
+}
+
+/**
+ * @brief At the start of every window of blockIds, read the whole window into the buffer pool in one batch,
+ * so the fetches that follow do not wait on the disk one block at a time.
+ */
+void Database::prefetchAhead(const std::vector<int64_t> &blockIds, int64_t position)
+{
+    if (position % PREFETCH_WINDOW == 0)
+    {
+        int64_t windowEnd = std::min<int64_t>(position + PREFETCH_WINDOW, blockIds.size());
+        bufferPool.prefetchBlocks(std::vector<int64_t>(blockIds.begin() + position, blockIds.begin() + windowEnd));
+    }
+}
+
+/**
+ * @brief Block IDs of the record addresses returned by the B+ tree, in the same order.
+ */
+static std::vector<int64_t> getAddressBlockIds(const std::vector<RecordPointer> &recordAddresses)
+{
+    std::vector<int64_t> blockIds;
+    blockIds.reserve(recordAddresses.size());
+    for (const RecordPointer &recordAddress : recordAddresses)
+    {
+        // Copied first, push_back would bind a reference to the packed blockId
+        int64_t blockId = recordAddress.blockId;
+        blockIds.push_back(blockId);
+    }
+    return blockIds;
+}
+
+/**
+ * @brief Order the blocks of the record addresses with the request scheduler, and report the modelled time saved.
+ */
+ScheduledBatch Database::scheduleBlockFetches(const std::vector<RecordPointer> &recordAddresses)
+{
+    ScheduledBatch batch = requestScheduler.schedule(getAddressBlockIds(recordAddresses));
+    std::cout << "Block fetches scheduled with " << requestScheduler.getPolicyName() << ": " << batch.blockIds.size()
+              << " blocks, modelled time saved: " << batch.getTimeSaved() << "ms" << std::endl;
+    return batch;
+}
+
+/**
+ * @brief Offsets of the record addresses grouped by block, so each block is fetched once.
+ */
+static std::unordered_map<int64_t, std::vector<int>> groupOffsetsByBlock(const std::vector<RecordPointer> &recordAddresses)
+{
+    std::unordered_map<int64_t, std::vector<int>> offsetsByBlock;
+    for (const RecordPointer &recordAddress : recordAddresses)
+    {
+        int64_t blockId = recordAddress.blockId;
+        offsetsByBlock[blockId].push_back(recordAddress.blockOffset);
+    }
+    return offsetsByBlock;
+}
+
+/**
+ * @brief Call visit(index) for the index of every record selected in selection, in slot order.
+ */
+template <typename Visit>
+static void forEachSelected(const Block::SelectionMask &selection, Visit visit)
+{
+    for (size_t word = 0; word < selection.size(); word++)
     {
-        blockId = freeBlockSlotHash.begin()->first;
-        // Consume a free slot
-        freeBlockSlotHash[blockId] -= 1;
-        if (freeBlockSlotHash[blockId] == 0)
+        for (uint64_t bits = selection[word]; bits != 0; bits &= bits - 1)
         {
-            freeBlockSlotHash.erase(blockId);
+            visit(word * 64 + __builtin_ctzll(bits));
         }
     }
-    return blockId;
 }
 
-void Database::incrementFreeBlock(int blockId)
+/**
+ * @brief Whether no record is selected in selection.
+ */
+static bool isSelectionEmpty(const Block::SelectionMask &selection)
 {
-    // search for the blockId in the freeBlockSlotHash,
-    // if not found (means it was full), add it to hash with 1 slot free
-    // else increment the free slot count
-    if (freeBlockSlotHash.find(blockId) == freeBlockSlotHash.end())
+    for (uint64_t word : selection)
     {
-        freeBlockSlotHash[blockId] = 1;
+        if (word != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Find a free slot in Blocks, if not found, create a new block. Consumes 1 record slot in the freeSpaceMap.
+ * The fullest block that still has room is preferred, so deleted slots are refilled before new blocks are created.
+ *
+ * @return blockId
+ */
+int64_t Database::getFreeBlock()
+{
+    int64_t blockId = freeSpaceMap.findBlockWithFreeSlot();
+    if (blockId == -1)
+    {
+        blockId = bufferPool.createBlock(blockLayout);
+        freeSpaceMap.setFreeSlots(blockId, Block::BLOCK_CAPACITY - 1); // -1 to account for the record being inserted
     }
     else
     {
-        freeBlockSlotHash[blockId] += 1;
+        freeSpaceMap.setFreeSlots(blockId, freeSpaceMap.getFreeSlots(blockId) - 1); // Consume a free slot
     }
+    return blockId;
 }
 
-void Database::insertRecord(const Record &record)
+void Database::incrementFreeBlock(int64_t blockId)
+{
+    freeSpaceMap.setFreeSlots(blockId, freeSpaceMap.getFreeSlots(blockId) + 1);
+}
+
+/**
+ * @brief Delete a record logically: tombstone it in its block and queue its index entry for cleanIndex().
+ */
+void Database::tombstoneRecord(Block &block, int64_t blockId, int offset)
+{
+    block.markDeleted(offset);
+    pendingIndexDeletes.push_back(RecordKeyPointerPair(block.retrieveRecord(offset).getNumVotes(), RecordPointer(blockId, offset)));
+}
+
+/**
+ * @brief Put the record into the fullest block with room. Returns false, after reporting the error, if it could not be stored.
+ */
+bool Database::storeRecord(const Record &record, int64_t &blockId, int &blockOffset)
 {
     try
     {
-        int blockId = getFreeBlock();
+        blockId = getFreeBlock();
 
-        // Insert the record into the block
-        Block block = diskManager.readBlock(blockId); // Read the block to insert the record into.
-        int blockOffset = block.getFreeIndex();       // Get the first free index slot in the block
+        // Insert the record into the block in place
+        WritePageGuard page = bufferPool.fetchPageWrite(blockId); // Pin the block to insert the record into.
+        Block &block = page.getBlock();
+        blockOffset = block.getFreeIndex(); // Get the first free index slot in the block
         if (blockOffset == -1)
         {
             throw std::runtime_error("Block is full");
-            // insertRecord(key, record);
-        }
-        else
-        {
-            block.insertRecord(record, blockOffset);
-            diskManager.writeBlock(blockId, block);
-            std::string numvotes = std::to_string(record.getNumVotes());
-            bptree.insertKey(record.getNumVotes(), blockId, blockOffset);
         }
+        block.insertRecord(record, blockOffset);
+        return true;
     }
     catch (std::runtime_error &e)
     {
         std::cerr << e.what() << std::endl;
+        return false;
     }
 }
 
-void Database::deleteRecordByBPTree(int attributeValue)
+void Database::insertRecord(const Record &record)
 {
-    double timeTaken = 0;
-    std::vector<std::tuple<int, int>> recordAddresses = bptree.exactSearch(attributeValue);
-    for (auto &recordAddress : recordAddresses)
+    int64_t blockId;
+    int blockOffset;
+    if (storeRecord(record, blockId, blockOffset))
     {
-        int blockId = std::get<0>(recordAddress); // depending on what is the return of bptree.search
-        int offset = std::get<1>(recordAddress);
-        Block block = diskManager.readBlock(blockId);
-        timeTaken += diskManager.simulateBlockAccessTime(blockId);
-        block.deleteRecord(offset);
-        diskManager.writeBlock(blockId, block);
-        timeTaken += diskManager.simulateBlockAccessTime(blockId);
-        incrementFreeBlock(blockId);
-        bptree.deleteKey(attributeValue);
+        bptree.insertKey(record.getNumVotes(), RecordPointer(blockId, blockOffset));
     }
 }
 
-void Database::deleteRecordsByLinearScan(int attributeValue)
+void Database::loadRecord(const Record &record)
 {
-    std::vector<int> blockIds = diskManager.getAllBlockIds();
-    int timeTaken = 0;
-    // Loop through all blocks
-    for (auto &blockId : blockIds)
+    int64_t blockId;
+    int blockOffset;
+    storeRecord(record, blockId, blockOffset);
+}
+
+/**
+ * @brief Collect the keys of the live records in one sequential pass over the blocks, sort them and bulk load
+ * a new B+ tree from them. Tombstoned records are left out, their entries are already queued for removal.
+ */
+void Database::buildIndex()
+{
+    storage->adviseAccessPattern(AccessPattern::Sequential);
+    std::vector<RecordKeyPointerPair> kpps;
+    std::vector<int64_t> blockIds = storage->getAllBlockIds();
+    for (int64_t blockId : blockIds)
     {
-        Block block = diskManager.readBlock(blockId);
-        timeTaken += diskManager.simulateBlockAccessTime(blockId);
+        ReadPageGuard page = bufferPool.fetchPageRead(blockId, AccessStrategy::Scan);
+        const Block &block = page.getBlock();
+        for (int i = 0; i < block.getNumSlots(); i++)
+        {
+            if (block.isRecordLive(i))
+            {
+                kpps.push_back(RecordKeyPointerPair(block.retrieveRecord(i).getNumVotes(), RecordPointer(blockId, i)));
+            }
+        }
+    }
+    bufferPool.releaseScanRing();
+    storage->adviseAccessPattern(AccessPattern::Normal);
+
+    sortByKey(kpps);
+    bptree.clear();
+    bptree.bulkLoad(kpps, indexFillFactor);
+}
 
-        // Retrieve all records in the block and delete the ones with the attribute value
-        std::vector<Record> blockRecords = block.retrieveAllRecords();
-        for (int i = 0; i < blockRecords.size(); i++)
+IOStats Database::deleteRecordByBPTree(int attributeValue)
+{
+    storage->adviseAccessPattern(AccessPattern::Random);
+    IOStats statsBefore = bufferPool.getIOStats();
+    std::vector<RecordPointer> recordAddresses = bptree.exactSearch(attributeValue);
+    std::unordered_map<int64_t, std::vector<int>> offsetsByBlock = groupOffsetsByBlock(recordAddresses);
+
+    // Visit every block once, in head order
+    ScheduledBatch batch = scheduleBlockFetches(recordAddresses);
+    for (int64_t position = 0; position < (int64_t)batch.blockIds.size(); position++)
+    {
+        prefetchAhead(batch.blockIds, position);
+        int64_t blockId = batch.blockIds[position];
+        WritePageGuard page = bufferPool.fetchPageWrite(blockId);
+        for (int offset : offsetsByBlock[blockId])
         {
-            if (blockRecords[i].getNumVotes() == attributeValue)
+            if (page.getBlock().isRecordLive(offset))
             {
-                block.deleteRecord(i);
-                incrementFreeBlock(blockId);
+                tombstoneRecord(page.getBlock(), blockId, offset);
             }
         }
-        // for each blockId edit and write once
-        diskManager.writeBlock(blockId, block);
-        timeTaken += diskManager.simulateBlockAccessTime(blockId);
     }
+    IOStats queryStats = endQuery(statsBefore);
+    queryStats.print(std::cout);
+    return queryStats;
+}
+
+IOStats Database::deleteRecordsByLinearScan(int attributeValue)
+{
+    storage->adviseAccessPattern(AccessPattern::Sequential);
+    IOStats statsBefore = bufferPool.getIOStats();
+    std::vector<int64_t> blockIds = storage->getAllBlockIds();
+    Block::SelectionMask selection;
+    // Loop through all blocks
+    for (int64_t position = 0; position < (int64_t)blockIds.size(); position++)
+    {
+        int64_t blockId = blockIds[position];
+
+        // Select the live records with the attribute value under a read pin, so blocks without a match stay clean
+        {
+            ReadPageGuard page = bufferPool.fetchPageRead(blockId, AccessStrategy::Scan);
+            page.getBlock().selectByNumVotes(attributeValue, attributeValue, selection);
+        }
+        if (isSelectionEmpty(selection))
+        {
+            continue;
+        }
+
+        // Pin the block again for writing, it is still in the pool, and delete the selected records in place
+        WritePageGuard page = bufferPool.fetchPageWrite(blockId, AccessStrategy::Scan);
+        Block &block = page.getBlock();
+        forEachSelected(selection, [&](int index)
+                        { tombstoneRecord(block, blockId, index); });
+    }
+    bufferPool.releaseScanRing();
     std::cout << "Number of blocks accessed: " << blockIds.size() << std::endl;
-    std::cout << "Time taken for linear: " << timeTaken << "ms" << std::endl;
+    IOStats queryStats = endQuery(statsBefore);
+    queryStats.print(std::cout);
+    std::cout << "Time taken for linear: " << queryStats.getElapsedTime() << "ms" << std::endl;
+    return queryStats;
 }
 
-std::vector<Record> Database::retrieveRecordByBPTree(int attributeValue)
+QueryResult Database::retrieveRecordByBPTree(int attributeValue)
 {
-    double timeTaken = 0;
-    int recordCount = 0;
+    storage->adviseAccessPattern(AccessPattern::Random);
+    IOStats statsBefore = bufferPool.getIOStats();
+    int64_t recordCount = 0;
     double totalAverageRating = 0;
     std::vector<Record> records;
-    std::vector<std::tuple<int, int>> recordAddresses = bptree.exactSearch(attributeValue);
-    for (auto &recordAddress : recordAddresses)
+    std::vector<RecordPointer> recordAddresses = bptree.exactSearch(attributeValue);
+    std::vector<int64_t> addressBlockIds = getAddressBlockIds(recordAddresses);
+    for (int64_t i = 0; i < (int64_t)recordAddresses.size(); i++)
     {
-        int blockId = std::get<0>(recordAddress);
-        int offset = std::get<1>(recordAddress);
-        Block block = diskManager.readBlock(blockId);
-        Record record = block.retrieveRecord(offset);
+        prefetchAhead(addressBlockIds, i);
+        int64_t blockId = recordAddresses[i].blockId;
+        int offset = recordAddresses[i].blockOffset;
+        ReadPageGuard page = bufferPool.fetchPageRead(blockId);
+        if (!page.getBlock().isRecordLive(offset)) // Deleted, but the index entry is not cleaned yet
+        {
+            continue;
+        }
+        Record record = page.getBlock().retrieveRecord(offset);
         records.push_back(record);
         recordCount++;
         totalAverageRating += record.getAverageRating();
-        timeTaken += diskManager.simulateBlockAccessTime(blockId);
     }
 
     double averageOfAverageRating = totalAverageRating / recordCount;
 
     std::cout << "Number of blocks accessed: " << recordAddresses.size() << std::endl;
+
+    IOStats queryStats = endQuery(statsBefore);
+    queryStats.print(std::cout);
     std::cout << "Average rating: " << std::fixed << std::setprecision(4) << averageOfAverageRating << std::endl;
-    std::cout << "Time taken for bpt: " << timeTaken << "ms" << std::endl;
+    std::cout << "Time taken for bpt: " << queryStats.getElapsedTime() << "ms" << std::endl;
     // std::cout << "Number of records: " << recordCount << std::endl;
-    return records;
+    return {records, queryStats};
 }
 
-std::vector<Record> Database::retrieveRecordByLinearScan(int attributeValue)
+QueryResult Database::retrieveRecordByLinearScan(int attributeValue)
 {
-    std::vector<int> blockIds = diskManager.getAllBlockIds();
+    storage->adviseAccessPattern(AccessPattern::Sequential);
+    IOStats statsBefore = bufferPool.getIOStats();
+    std::vector<int64_t> blockIds = storage->getAllBlockIds();
     std::vector<Record> queryResult;
-    double timeTaken = 0;
-    int recordCount = 0;
+    int64_t recordCount = 0;
     double totalAverageRating = 0;
-    for (auto &blockId : blockIds)
+    Block::SelectionMask selection;
+    for (int64_t i = 0; i < (int64_t)blockIds.size(); i++)
     {
-        Block block = diskManager.readBlock(blockId);
-        timeTaken += diskManager.simulateBlockAccessTime(blockId);
-        std::vector<Record> blockRecords = block.retrieveAllRecords();
-        for (auto &record : blockRecords)
-        {
-            if (record.getNumVotes() == attributeValue)
-            {
-                queryResult.push_back(record);
-                recordCount++;
-                totalAverageRating += record.getAverageRating();
-            }
-        }
+        int64_t blockId = blockIds[i];
+        ReadPageGuard page = bufferPool.fetchPageRead(blockId, AccessStrategy::Scan);
+        const Block &block = page.getBlock();
+        block.selectByNumVotes(attributeValue, attributeValue, selection);
+        forEachSelected(selection, [&](int index)
+                        {
+            queryResult.push_back(block.retrieveRecord(index));
+            recordCount++;
+            totalAverageRating += queryResult.back().getAverageRating(); });
     }
+    bufferPool.releaseScanRing();
     double averageOfAverageRating = totalAverageRating / recordCount;
     std::cout << "Number of blocks accessed: " << blockIds.size() << std::endl;
+    IOStats queryStats = endQuery(statsBefore);
+    queryStats.print(std::cout);
     // std::cout << "Number of records: " << recordCount << std::endl;
     std::cout << "Average rating: " << std::fixed << std::setprecision(4) << averageOfAverageRating << std::endl;
-    std::cout << "Time taken for linear: " << timeTaken << "ms" << std::endl;
+    std::cout << "Time taken for linear: " << queryStats.getElapsedTime() << "ms" << std::endl;
 
     std::sort(queryResult.begin(), queryResult.end(), [](const Record &a, const Record &b)
               { return a.getTconst() < b.getTconst(); });
 
-    return queryResult;
+    return {queryResult, queryStats};
 }
 
-std::vector<Record> Database::retrieveRangeRecordsByBPTree(int start, int end)
+QueryResult Database::retrieveRangeRecordsByBPTree(int start, int end)
 {
-    double timeTaken = 0;
+    storage->adviseAccessPattern(AccessPattern::Random);
+    IOStats statsBefore = bufferPool.getIOStats();
     std::vector<Record> records;
-    int recordCount = 0;
+    int64_t recordCount = 0;
     double totalAverageRating = 0;
-    std::vector<std::tuple<int, int>> recordAddresses = bptree.rangeSearch(start, end);
-    for (auto &recordAddress : recordAddresses)
+    std::vector<RecordPointer> recordAddresses = bptree.rangeSearch(start, end);
+    std::unordered_map<int64_t, std::vector<int>> offsetsByBlock = groupOffsetsByBlock(recordAddresses);
+
+    // Visit every block once, in head order
+    ScheduledBatch batch = scheduleBlockFetches(recordAddresses);
+    for (int64_t position = 0; position < (int64_t)batch.blockIds.size(); position++)
     {
-        int blockId = std::get<0>(recordAddress);
-        int offset = std::get<1>(recordAddress);
-        Block block = diskManager.readBlock(blockId);
-        Record record = block.retrieveRecord(offset);
-        records.push_back(record);
-        recordCount++;
-        totalAverageRating += record.getAverageRating();
-        timeTaken += diskManager.simulateBlockAccessTime(blockId);
+        prefetchAhead(batch.blockIds, position);
+        int64_t blockId = batch.blockIds[position];
+        ReadPageGuard page = bufferPool.fetchPageRead(blockId);
+        for (int offset : offsetsByBlock[blockId])
+        {
+            if (!page.getBlock().isRecordLive(offset)) // Deleted, but the index entry is not cleaned yet
+            {
+                continue;
+            }
+            Record record = page.getBlock().retrieveRecord(offset);
+            records.push_back(record);
+            recordCount++;
+            totalAverageRating += record.getAverageRating();
+        }
     }
     double averageOfAverageRating = totalAverageRating / recordCount;
     std::cout << "Number of blocks accessed: " << recordAddresses.size() << std::endl;
+    IOStats queryStats = endQuery(statsBefore);
+    queryStats.print(std::cout);
     // std::cout << "Number of records: " << recordCount << std::endl;
     std::cout << "Average rating: " << std::fixed << std::setprecision(4) << averageOfAverageRating << std::endl;
-    std::cout << "Time taken for bpt: " << timeTaken << "ms" << std::endl;
-    return records;
+    std::cout << "Time taken for bpt: " << queryStats.getElapsedTime() << "ms" << std::endl;
+    return {records, queryStats};
 }
 
-std::vector<Record> Database::retrieveRangeRecordsByLinearScan(int start, int end)
+QueryResult Database::retrieveRangeRecordsByLinearScan(int start, int end)
 {
+    storage->adviseAccessPattern(AccessPattern::Sequential);
+    IOStats statsBefore = bufferPool.getIOStats();
     // Assuming numerical
-    std::vector<int> blockIds = diskManager.getAllBlockIds();
+    std::vector<int64_t> blockIds = storage->getAllBlockIds();
     std::vector<Record> queryResult;
-    double timeTaken = 0;
-    int recordCount = 0;
+    int64_t recordCount = 0;
     double totalAverageRating = 0;
+    Block::SelectionMask selection;
 
-    for (auto &blockId : blockIds)
+    for (int64_t i = 0; i < (int64_t)blockIds.size(); i++)
     {
+        int64_t blockId = blockIds[i];
         // std::shared_ptr<Block> block = diskManager.readBlock(blockId);
-        Block block = diskManager.readBlock(blockId);
-        timeTaken += diskManager.simulateBlockAccessTime(blockId);
-        std::vector<Record> blockRecords = block.retrieveAllRecords();
-
-        for (auto &record : blockRecords)
-        {
-            if (record.getNumVotes() >= start && record.getNumVotes() <= end)
-            {
-                queryResult.push_back(record);
-                recordCount++;
-                totalAverageRating += record.getAverageRating();
-            }
-        }
+        ReadPageGuard page = bufferPool.fetchPageRead(blockId, AccessStrategy::Scan);
+        const Block &block = page.getBlock();
+        block.selectByNumVotes(start, end, selection);
+        forEachSelected(selection, [&](int index)
+                        {
+            queryResult.push_back(block.retrieveRecord(index));
+            recordCount++;
+            totalAverageRating += queryResult.back().getAverageRating(); });
     }
+    bufferPool.releaseScanRing();
 
     double averageOfAverageRating = totalAverageRating / recordCount;
 
     std::cout << "Number of blocks accessed: " << blockIds.size() << std::endl;
+
+    IOStats queryStats = endQuery(statsBefore);
+    queryStats.print(std::cout);
     // std::cout << "Number of records: " << recordCount << std::endl;
     std::cout << "Average rating: " << std::fixed << std::setprecision(4) << averageOfAverageRating << std::endl;
-    std::cout << "Time taken for linear: " << timeTaken << "ms" << std::endl;
+    std::cout << "Time taken for linear: " << queryStats.getElapsedTime() << "ms" << std::endl;
 
     std::sort(queryResult.begin(), queryResult.end(), [](const Record &a, const Record &b)
               { return a.getTconst() < b.getTconst(); });
 
-    return queryResult;
+    return {queryResult, queryStats};
+}
+
+/**
+ * @brief Run the next slice of the compaction pass. A pass visits the blocks that existed when it started,
+ * from the last one to the first, so records move towards the start of the storage and the blocks at the
+ * end are the ones that get freed. Blocks are read with the scan strategy, like a linear scan.
+ * The B+ tree pointers of the moved records are rewritten at the end of the slice, in one pass over the
+ * leaves, so a slice should cover enough blocks to make that pass worth it.
+ */
+CompactionResult Database::compact(int64_t maxBlocks)
+{
+    IOStats statsBefore = bufferPool.getIOStats();
+    CompactionResult result;
+    std::vector<RecordMove> moves;
+    applyIndexDeletes(pendingIndexDeletes.size()); // Records must not move while index entries still point at their tombstones
+    if (compactionPosition < 0)
+    {
+        compactionBlockIds = storage->getAllBlockIds();
+        compactionPosition = (int64_t)compactionBlockIds.size() - 1;
+    }
+    while (result.blocksVisited < maxBlocks && compactionPosition >= 0)
+    {
+        int64_t blockId = compactionBlockIds[compactionPosition--];
+        result.blocksVisited++;
+        if (storage->hasBlock(blockId))
+        {
+            compactBlock(blockId, moves, result);
+        }
+    }
+    bufferPool.releaseScanRing();
+    bptree.updateRecordPointers(moves);
+    if (compactionPosition < 0)
+    {
+        compactionBlockIds = std::vector<int64_t>(); // Release the capacity as well
+        result.passFinished = true;
+    }
+    result.ioStats = endQuery(statsBefore);
+    return result;
+}
+
+/**
+ * @brief Move every record of a partially empty block into the fullest blocks that have room, then free it.
+ * Only blocks at least as full as this one are used, and only if they can take every record, so records
+ * are never moved without freeing a block and the same records do not move back and forth. Full blocks
+ * are skipped using the free space map alone, without reading them.
+ */
+void Database::compactBlock(int64_t blockId, std::vector<RecordMove> &moves, CompactionResult &result)
+{
+    int numFreeSlots = freeSpaceMap.getFreeSlots(blockId);
+    if (numFreeSlots == 0)
+    {
+        return;
+    }
+    freeSpaceMap.setFreeSlots(blockId, 0); // Keep the block from being picked as a target for its own records
+    if (freeSpaceMap.countFreeSlots(numFreeSlots) < Block::BLOCK_CAPACITY - numFreeSlots)
+    {
+        freeSpaceMap.setFreeSlots(blockId, numFreeSlots);
+        return;
+    }
+
+    {
+        WritePageGuard page = bufferPool.fetchPageWrite(blockId, AccessStrategy::Scan);
+        Block &block = page.getBlock();
+        for (int i = 0; i < block.getNumSlots(); i++)
+        {
+            if (!block.isSlotOccupied(i))
+            {
+                continue;
+            }
+            Record record = block.retrieveRecord(i);
+            int64_t targetBlockId = freeSpaceMap.findBlockWithFreeSlot();
+            WritePageGuard targetPage = bufferPool.fetchPageWrite(targetBlockId);
+            int targetOffset = targetPage.getBlock().getFreeIndex();
+            if (targetOffset == -1)
+            {
+                throw std::runtime_error("Free space map lists full block " + std::to_string(targetBlockId));
+            }
+            targetPage.getBlock().insertRecord(record, targetOffset);
+            freeSpaceMap.setFreeSlots(targetBlockId, freeSpaceMap.getFreeSlots(targetBlockId) - 1);
+            block.deleteRecord(i);
+            moves.push_back({record.getNumVotes(), RecordPointer(blockId, i), RecordPointer(targetBlockId, targetOffset)});
+            result.recordsMoved++;
+        }
+    }
+    bufferPool.deleteBlock(blockId); // The page guard is released, so the frame can be dropped
+    result.blocksFreed++;
+}
+
+int64_t Database::cleanIndex(int64_t maxDeletes)
+{
+    IOStats statsBefore = bufferPool.getIOStats();
+    int64_t numCleaned = applyIndexDeletes(maxDeletes);
+    endQuery(statsBefore);
+    return numCleaned;
+}
+
+/**
+ * @brief Take the oldest queued index deletes, remove their entries from the B+ tree sorted by key, so
+ * every key is looked up once, then free the slots of the records block by block.
+ */
+int64_t Database::applyIndexDeletes(int64_t maxDeletes)
+{
+    int64_t batchSize = std::min<int64_t>(maxDeletes, pendingIndexDeletes.size());
+    std::vector<RecordKeyPointerPair> batch(pendingIndexDeletes.begin(), pendingIndexDeletes.begin() + batchSize);
+    pendingIndexDeletes.erase(pendingIndexDeletes.begin(), pendingIndexDeletes.begin() + batchSize);
+
+    sortByKey(batch);
+    bptree.removeRecordPointers(batch);
+
+    // No index entry points at the records any more, so their slots can be reused
+    std::sort(batch.begin(), batch.end(), [](const RecordKeyPointerPair &a, const RecordKeyPointerPair &b)
+              { return a.pointer < b.pointer; });
+    for (int64_t i = 0; i < batchSize;)
+    {
+        int64_t blockId = batch[i].pointer.blockId;
+        WritePageGuard page = bufferPool.fetchPageWrite(blockId);
+        for (; i < batchSize && batch[i].pointer.blockId == blockId; i++)
+        {
+            page.getBlock().deleteRecord(batch[i].pointer.blockOffset);
+            incrementFreeBlock(blockId);
+        }
+    }
+    return batchSize;
 }
@@ -7,6 +7,18 @@
  * It provides a simplified model of database operations, including inserting, searching, deleting records,
  * and retrieving range of records. It also provides a simplified model of disk operations, including simulating
  * block read and write operations, block allocation and deallocation, and disk space management.
+ *
+ * Deletes leave holes in the blocks. compact() moves the records of partially empty blocks into the
+ * fullest blocks that have room, frees the blocks it empties and points the B+ tree at the new addresses.
+ * Each call only visits a bounded number of blocks, so compaction can be run in slices between queries.
+ *
+ * Records can be loaded without indexing them, with loadRecord(), and indexed all at once afterwards with
+ * buildIndex(), which builds the B+ tree bottom-up from the sorted keys instead of inserting them one by one.
+ * Opening an existing data file builds its index the same way.
+ *
+ * Deletes are logical: the records are tombstoned in their blocks, which lookups and scans skip, and
+ * their index entries are queued. cleanIndex() later removes queued entries from the B+ tree in sorted
+ * batches and only then frees the slots, so a delete costs O(matches) and no tree work.
  */
 
 #ifndef DATABASE_H
@@ -14,38 +26,124 @@
 
 #include "block.h"
 #include "disk_manager.h"
+#include "striped_disk_manager.h"
+#include "buffer_pool.h"
 #include "b_plus_tree.h"
+#include "free_space_map.h"
+#include "io_stats.h"
+#include "request_scheduler.h"
 
+#include <deque>
 #include <memory>
-#include <unordered_map>
+#include <string>
 
 typedef unsigned int uint;
 typedef unsigned char uchar;
 
+/**
+ * Storage and caching options of a Database. The defaults keep the blocks in main memory.
+ */
+struct DatabaseConfig
+{
+    StorageMode storageMode = StorageMode::InMemory;
+    std::string dataFilePath;                                          // Data file used by StorageMode::File and StorageMode::MemoryMapped
+    bool openExisting = false;                                         // Reuse the blocks already in the data file instead of starting empty
+    int bufferPoolFrames = 1024;                                       // Number of blocks cached by the buffer pool
+    ReplacementPolicyType replacementPolicy = ReplacementPolicyType::Clock;
+    int lruK = 2;                                                      // K used by ReplacementPolicyType::LRUK
+    unsigned accessModelSeed = 0;                                      // Start state of the modelled disk, see DiskManager::seedAccessModel
+    int numDevices = 1;                                                // More than one stripes the blocks over that many disks, see StripedDiskManager
+    int stripeWidth = 8;                                               // Consecutive blocks stored on the same device when striping
+    SchedulingPolicy schedulingPolicy = SchedulingPolicy::CLOOK;       // Order of the block fetches of B+ tree range queries and deletes
+    int maxHotChunks = 0;                                              // InMemory mode: uncompressed chunks of blocks kept, see TieredBlockArena. 0 turns tiering off
+    BlockLayout blockLayout = BlockLayout::Row;                        // Layout of the blocks created for new records, see Block
+    double indexFillFactor = 1.0;                                      // Share of each B+ tree node filled by buildIndex(), see BPTree::bulkLoad
+};
+
+/**
+ * Records returned by a query, together with the I/O the query performed.
+ */
+struct QueryResult
+{
+    std::vector<Record> records;
+    IOStats ioStats;
+};
+
+/**
+ * Work done by one step of the compaction pass, see Database::compact.
+ */
+struct CompactionResult
+{
+    int64_t blocksVisited = 0; // Blocks considered for merging in this step
+    int64_t recordsMoved = 0;
+    int64_t blocksFreed = 0;   // Emptied blocks given back to the storage
+    bool passFinished = false; // Every block has been visited, the next step starts a new pass
+    IOStats ioStats;
+};
+
 class Database
 {
 private:
-    DiskManager diskManager;                        // Simulate disk storage operations such as reading blocks, writing blocks
-    BPTree bptree;                                  // Simulate B+ tree operations such as inserting, searching, deleting records, merging nodes, splitting nodes
-    std::unordered_map<int, int> freeBlockSlotHash; // Map block ID to the number of free slots in the block
+    std::unique_ptr<BlockStorage> storage; // Simulate disk storage operations such as reading blocks, writing blocks
+    BufferPool bufferPool;                 // Cache blocks of the disk manager, all block reads and writes go through it
+    RecordIndex bptree;                    // Simulate B+ tree operations such as inserting, searching, deleting records, merging nodes, splitting nodes
+    FreeSpaceMap freeSpaceMap;             // Number of free slots per block, used to place inserts into the fullest block with room
+    IOStats sessionIOStats;                // Sum of the I/O of every query since the database was opened
+    RequestScheduler requestScheduler;     // Orders the block fetches of a query by track
+    BlockLayout blockLayout;               // Layout of the blocks created by getFreeBlock()
+    double indexFillFactor;                // Fill factor of the B+ tree nodes built by buildIndex()
+
+    // State of the compaction pass, which visits the blocks from the last one to the first
+    std::vector<int64_t> compactionBlockIds; // Blocks of the current pass, empty if no pass is running
+    int64_t compactionPosition = -1;         // Position in compactionBlockIds of the next block to visit
 
-    int getFreeBlock();
-    void incrementFreeBlock(int blockId);
+    std::deque<RecordKeyPointerPair> pendingIndexDeletes; // Tombstoned records whose index entries are not removed yet, oldest first
+
+    static const int PREFETCH_WINDOW = 64; // Blocks read ahead in one batch by index lookups
+
+    int64_t getFreeBlock();
+    void incrementFreeBlock(int64_t blockId);
+    void loadExistingRecords();
+    bool storeRecord(const Record &record, int64_t &blockId, int &blockOffset);
+    static std::unique_ptr<BlockStorage> createStorage(int64_t databaseSize, const DatabaseConfig &config);
+    void prefetchAhead(const std::vector<int64_t> &blockIds, int64_t position);
+    IOStats endQuery(const IOStats &statsBefore);
+    ScheduledBatch scheduleBlockFetches(const std::vector<RecordPointer> &recordAddresses);
+    std::string getFreeSpaceMapPath() const; // File the free space map is saved to, empty in StorageMode::InMemory
+    void compactBlock(int64_t blockId, std::vector<RecordMove> &moves, CompactionResult &result);
+    void tombstoneRecord(Block &block, int64_t blockId, int offset);
+    int64_t applyIndexDeletes(int64_t maxDeletes);
 
 public:
-    Database(uint databaseSize);
+    Database(int64_t databaseSize, const DatabaseConfig &config = DatabaseConfig());
     ~Database();
 
-    BPTree getBPTree() const { return bptree; };
-    DiskManager getDiskManager() const { return diskManager; };
+    const RecordIndex &getBPTree() const { return bptree; };
+    const BlockStorage &getStorage(); // Flushes the buffer pool so the disk reflects every write
+    const BufferPool &getBufferPool() const { return bufferPool; };
 
     void insertRecord(const Record &record);
-    void deleteRecordByBPTree(int attributeValue);
-    void deleteRecordsByLinearScan(int attributeValue);
-    std::vector<Record> retrieveRecordByBPTree(int attributeValue);
-    std::vector<Record> retrieveRecordByLinearScan(int attributeValue);
-    std::vector<Record> retrieveRangeRecordsByBPTree(int start, int end);
-    std::vector<Record> retrieveRangeRecordsByLinearScan(int start, int end);
+
+    // Store a record in a block without adding it to the B+ tree. Call buildIndex() once the records are loaded
+    void loadRecord(const Record &record);
+
+    // Replace the B+ tree with one bulk loaded from the live records of the blocks, see BPTree::bulkLoad
+    void buildIndex();
+    IOStats deleteRecordByBPTree(int attributeValue);
+    IOStats deleteRecordsByLinearScan(int attributeValue);
+    QueryResult retrieveRecordByBPTree(int attributeValue);
+    QueryResult retrieveRecordByLinearScan(int attributeValue);
+    QueryResult retrieveRangeRecordsByBPTree(int start, int end);
+    QueryResult retrieveRangeRecordsByLinearScan(int start, int end);
+    const IOStats &getSessionIOStats() const { return sessionIOStats; };
+
+    // Visit up to maxBlocks blocks of the compaction pass, merging partially empty blocks and freeing the emptied ones
+    CompactionResult compact(int64_t maxBlocks);
+
+    // Remove up to maxDeletes queued index entries of deleted records from the B+ tree and free their slots.
+    // Returns the number cleaned. Meant to run between queries
+    int64_t cleanIndex(int64_t maxDeletes);
+    int64_t getNumPendingIndexDeletes() const { return pendingIndexDeletes.size(); };
 };
 
 #endif // DATABASE_H
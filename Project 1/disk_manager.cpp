@@ -1,12 +1,249 @@
 #include "disk_manager.h"
 #include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <random>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-DiskManager::DiskManager(int diskSize)
-    : nextBlockId(0), numOfSurface(1), blocksPerSector(2), sectorsPerTrack(256),
-      currentHeadPosition(0), rotationalSpeedRPM(5400), cacheHitRate(0.1), averageCacheAccessTime(0.001)
+// Pages are moved to and from the data file as raw bytes
+static_assert(std::is_trivially_copyable<Block>::value, "Block must be trivially copyable to be stored in the data file");
+static_assert(sizeof(Block) == DiskManager::BLOCK_SIZE, "Block must be exactly one page");
+
+DiskManager::DiskManager(int64_t diskSize, StorageMode storageMode, const std::string &dataFilePath, bool openExisting)
+    : nextBlockId(0), numBlocksUsed(0), storageMode(storageMode), dataFilePath(dataFilePath), dataFileFd(-1),
+      mappedData(nullptr), mappedLength(0), numMappedFileBlocks(0),
+      numOfSurface(1), blocksPerSector(2), sectorsPerTrack(256),
+      currentHeadPosition(0), lastAccessedBlockId(-1), deviceIndex(0), rotationalSpeedRPM(5400),
+      numChecksumsVerified(0), numChecksumFailures(0)
 {
     DISK_SIZE = diskSize;
     updateDiskConfigurations();
+    if (storageMode != StorageMode::InMemory)
+    {
+        openDataFile(openExisting);
+    }
+}
+
+DiskManager::~DiskManager()
+{
+    if (mappedData != nullptr)
+    {
+        munmap(mappedData, mappedLength);
+        // The file was grown in whole chunks, trim it back to the blocks actually created
+        if (ftruncate(dataFileFd, blockIdToFileOffset(nextBlockId)) == -1)
+        {
+            std::cerr << "Failed to trim data file " << dataFilePath << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+    asyncReader.reset(); // Stop the reader before its file descriptor is closed
+    if (dataFileFd != -1)
+    {
+        close(dataFileFd);
+    }
+}
+
+void DiskManager::openDataFile(bool openExisting)
+{
+    if (dataFilePath.empty())
+    {
+        throw std::invalid_argument("File and MemoryMapped storage modes require a data file path");
+    }
+    // Without openExisting, start from an empty file
+    dataFileFd = open(dataFilePath.c_str(), O_RDWR | O_CREAT | (openExisting ? 0 : O_TRUNC), 0644);
+    if (dataFileFd == -1)
+    {
+        throw std::runtime_error("Failed to open data file " + dataFilePath + ": " + std::strerror(errno));
+    }
+
+    struct stat fileStat;
+    if (fstat(dataFileFd, &fileStat) == -1)
+    {
+        throw std::runtime_error("Failed to stat data file " + dataFilePath + ": " + std::strerror(errno));
+    }
+    int64_t numFileBlocks = fileStat.st_size / BLOCK_SIZE;
+    if (numFileBlocks > getTotalBlockCapacity())
+    {
+        throw std::runtime_error("Data file " + dataFilePath + " is larger than the disk");
+    }
+
+    if (storageMode == StorageMode::MemoryMapped)
+    {
+        // Reserve address space for the whole disk, the file itself is grown chunk by chunk in createBlock()
+        mappedLength = static_cast<size_t>(getTotalBlockCapacity()) * BLOCK_SIZE;
+        void *mapping = mmap(nullptr, mappedLength, PROT_READ | PROT_WRITE, MAP_SHARED, dataFileFd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            throw std::runtime_error("Failed to map data file " + dataFilePath + ": " + std::strerror(errno));
+        }
+        mappedData = static_cast<uint8_t *>(mapping);
+        numMappedFileBlocks = numFileBlocks;
+    }
+    else
+    {
+        asyncReader = std::make_unique<AsyncReader>(dataFileFd, ASYNC_QUEUE_DEPTH);
+    }
+
+    loadBlockDirectory(numFileBlocks);
+}
+
+/**
+ * @brief Rebuild the block directory from the pages of an existing data file.
+ * Created blocks always have a formatted header, while deleted blocks are zeroed out, so a zero page is free.
+ */
+void DiskManager::loadBlockDirectory(int64_t numFileBlocks)
+{
+    static const Block zeroPage = []
+    {
+        Block block;
+        std::memset(reinterpret_cast<void *>(&block), 0, sizeof(Block));
+        return block;
+    }();
+
+    Block block;
+    for (int64_t blockId = 0; blockId < numFileBlocks; blockId++)
+    {
+        readPage(blockId, block);
+        bool isUsed = std::memcmp(&block, &zeroPage, sizeof(Block)) != 0;
+        allocatedBlocks.push_back(isUsed);
+        if (isUsed)
+        {
+            numBlocksUsed++;
+        }
+        else
+        {
+            freeBlockIds.push(blockId);
+        }
+    }
+    nextBlockId = numFileBlocks;
+}
+
+// Each block lives at a fixed offset in the data file, so a block ID is all that is needed to locate it
+off_t DiskManager::blockIdToFileOffset(int64_t blockId) const
+{
+    return static_cast<off_t>(blockId) * BLOCK_SIZE;
+}
+
+void DiskManager::readPage(int64_t blockId, Block &block) const
+{
+    if (storageMode == StorageMode::MemoryMapped)
+    {
+        std::memcpy(&block, mappedData + blockIdToFileOffset(blockId), BLOCK_SIZE);
+        return;
+    }
+
+    char *buffer = reinterpret_cast<char *>(&block);
+    size_t remaining = BLOCK_SIZE;
+    off_t offset = blockIdToFileOffset(blockId);
+    while (remaining > 0)
+    {
+        ssize_t bytesRead = pread(dataFileFd, buffer, remaining, offset);
+        if (bytesRead == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesRead <= 0)
+        {
+            throw std::runtime_error("Failed to read block " + std::to_string(blockId) + " from data file: " +
+                                     (bytesRead == 0 ? "unexpected end of file" : std::strerror(errno)));
+        }
+        buffer += bytesRead;
+        offset += bytesRead;
+        remaining -= bytesRead;
+    }
+}
+
+void DiskManager::writePage(int64_t blockId, const Block &block)
+{
+    if (storageMode == StorageMode::MemoryMapped)
+    {
+        std::memcpy(mappedData + blockIdToFileOffset(blockId), &block, BLOCK_SIZE);
+        return;
+    }
+
+    const char *buffer = reinterpret_cast<const char *>(&block);
+    size_t remaining = BLOCK_SIZE;
+    off_t offset = blockIdToFileOffset(blockId);
+    while (remaining > 0)
+    {
+        ssize_t bytesWritten = pwrite(dataFileFd, buffer, remaining, offset);
+        if (bytesWritten == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytesWritten <= 0)
+        {
+            throw std::runtime_error("Failed to write block " + std::to_string(blockId) + " to data file: " + std::strerror(errno));
+        }
+        buffer += bytesWritten;
+        offset += bytesWritten;
+        remaining -= bytesWritten;
+    }
+}
+
+/**
+ * @brief Check the checksum of a page that was just read, counting and reporting a mismatch.
+ */
+void DiskManager::verifyPage(int64_t blockId, const Block &block) const
+{
+    numChecksumsVerified++;
+    if (!block.verifyChecksum())
+    {
+        numChecksumFailures++;
+        throw std::runtime_error("Checksum mismatch in block " + std::to_string(blockId) + ", the page is corrupt");
+    }
+}
+
+/**
+ * @brief Make sure the data file covers the block, so that touching it through the mapping does not fault.
+ */
+void DiskManager::growMappedFile(int64_t blockId)
+{
+    if (blockId < numMappedFileBlocks)
+    {
+        return;
+    }
+    int64_t newNumBlocks = std::min(getTotalBlockCapacity(), (blockId / BLOCKS_PER_CHUNK + 1) * BLOCKS_PER_CHUNK);
+    if (ftruncate(dataFileFd, blockIdToFileOffset(newNumBlocks)) == -1)
+    {
+        throw std::runtime_error("Failed to grow data file " + dataFilePath + ": " + std::strerror(errno));
+    }
+    numMappedFileBlocks = newNumBlocks;
+}
+
+const Block *DiskManager::getMappedBlock(int64_t blockId) const
+{
+    if (storageMode != StorageMode::MemoryMapped || !hasBlock(blockId))
+    {
+        return nullptr;
+    }
+    const Block *mappedBlock = reinterpret_cast<const Block *>(mappedData + blockIdToFileOffset(blockId));
+    verifyPage(blockId, *mappedBlock);
+    return mappedBlock;
+}
+
+void DiskManager::adviseAccessPattern(AccessPattern accessPattern)
+{
+    if (storageMode == StorageMode::MemoryMapped)
+    {
+        int advice = accessPattern == AccessPattern::Sequential ? MADV_SEQUENTIAL
+                     : accessPattern == AccessPattern::Random   ? MADV_RANDOM
+                                                                : MADV_NORMAL;
+        madvise(mappedData, mappedLength, advice); // Only a hint, failure is harmless
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    else if (storageMode == StorageMode::File)
+    {
+        int advice = accessPattern == AccessPattern::Sequential ? POSIX_FADV_SEQUENTIAL
+                     : accessPattern == AccessPattern::Random   ? POSIX_FADV_RANDOM
+                                                                : POSIX_FADV_NORMAL;
+        posix_fadvise(dataFileFd, 0, 0, advice);
+    }
+#endif
 }
 
 void DiskManager::updateDiskConfigurations()
@@ -15,78 +252,227 @@ void DiskManager::updateDiskConfigurations()
     tracksPerSurface = DISK_SIZE / (sectorsPerTrack * bytesPerSector * numOfSurface);
 }
 
-// @deprecated this shares the reference to the block, allowing the caller to modify the block directly, which is incorrect.
-// std::shared_ptr<Block> DiskManager::readBlock(int blockId)
-// {
-//     if (blocks.find(blockId) == blocks.end())
-//     {
-//         throw std::runtime_error("Block not found");
-//     }
-//     return blocks[blockId];
-// }
+/**
+ * @brief Return the in-memory slot of a block, bringing its chunk back into the hot tier if it is compressed.
+ * The reference is only valid until the next access to another block.
+ */
+Block &DiskManager::blockSlot(int64_t blockId)
+{
+    return blockArena.getBlock(blockId);
+}
+
+const Block &DiskManager::blockSlot(int64_t blockId) const
+{
+    return blockArena.getBlock(blockId);
+}
 
 // copy to main memory version
-Block DiskManager::readBlock(int blockId) const
+void DiskManager::readBlock(int64_t blockId, Block &block) const
 {
-    if (blocks.find(blockId) == blocks.end())
+    if (!hasBlock(blockId))
     {
         throw std::runtime_error("Block not found");
     }
-    return *blocks.at(blockId);
+    if (storageMode != StorageMode::InMemory)
+    {
+        readPage(blockId, block);
+    }
+    else
+    {
+        block = blockSlot(blockId);
+    }
+    verifyPage(blockId, block);
 }
 
-void DiskManager::writeBlock(int blockId, Block block)
+void DiskManager::readBlocks(const std::vector<int64_t> &blockIds, const std::vector<Block *> &destinations, const std::function<void(int)> &onBlockRead) const
 {
-    if (blocks.find(blockId) != blocks.end())
+    for (int64_t blockId : blockIds)
+    {
+        if (!hasBlock(blockId))
+        {
+            throw std::runtime_error("Block not found");
+        }
+    }
+    if (asyncReader == nullptr)
     {
-        // If the blockId exists, update the existing block with the new block data
-        *blocks[blockId] = block;
+        // The blocks are already in memory, there is no latency to hide
+        for (int i = 0; i < (int)blockIds.size(); i++)
+        {
+            readBlock(blockIds[i], *destinations[i]);
+            onBlockRead(i);
+        }
+        return;
     }
+
+    std::vector<ReadRequest> requests;
+    requests.reserve(blockIds.size());
+    for (int i = 0; i < (int)blockIds.size(); i++)
+    {
+        requests.push_back({blockIdToFileOffset(blockIds[i]), destinations[i], BLOCK_SIZE});
+    }
+    asyncReader->readBatch(requests, [&](int i, bool success)
+                           {
+                               if (!success)
+                               {
+                                   readPage(blockIds[i], *destinations[i]); // Retry synchronously, which reports the actual error
+                               }
+                               verifyPage(blockIds[i], *destinations[i]);
+                               onBlockRead(i); });
 }
 
-int DiskManager::createBlock()
+void DiskManager::writeBlock(int64_t blockId, const Block &block)
 {
-    if (blocks.size() >= DISK_SIZE / BLOCK_SIZE)
+    // If the blockId exists, update the existing block with the new block data
+    if (!hasBlock(blockId))
     {
-        throw std::runtime_error("Disk is full");
+        return;
     }
-    int blockId = nextBlockId++;
-    auto newBlock = std::make_shared<Block>();
-    blocks[blockId] = newBlock;
+    Block page = block;
+    page.updateChecksum();
+    if (storageMode != StorageMode::InMemory)
+    {
+        writePage(blockId, page);
+        return;
+    }
+    blockSlot(blockId) = page;
+}
+
+bool DiskManager::hasBlock(int64_t blockId) const
+{
+    return blockId >= 0 && blockId < nextBlockId && allocatedBlocks[blockId];
+}
+
+int64_t DiskManager::createBlock()
+{
+    // Reuse the lowest deleted block ID first so that the used IDs stay dense.
+    // IDs taken by createBlockWithId() since they were freed are skipped.
+    while (!freeBlockIds.empty() && allocatedBlocks[freeBlockIds.top()])
+    {
+        freeBlockIds.pop();
+    }
+    int64_t blockId = freeBlockIds.empty() ? nextBlockId : freeBlockIds.top();
+    createBlockWithId(blockId);
     return blockId;
 }
 
-void DiskManager::deleteBlock(int blockId)
+void DiskManager::createBlockWithId(int64_t blockId)
+{
+    if (getNumBlocksUsed() >= getTotalBlockCapacity() || blockId >= getTotalBlockCapacity())
+    {
+        throw std::runtime_error("Disk is full");
+    }
+    if (blockId < 0 || hasBlock(blockId))
+    {
+        throw std::invalid_argument("Block " + std::to_string(blockId) + " cannot be created");
+    }
+
+    // Extend the directory up to the block, the IDs skipped on the way are free
+    while (nextBlockId <= blockId)
+    {
+        allocatedBlocks.push_back(false);
+        if (nextBlockId < blockId)
+        {
+            freeBlockIds.push(nextBlockId);
+        }
+        nextBlockId++;
+    }
+    if (!freeBlockIds.empty() && freeBlockIds.top() == blockId)
+    {
+        freeBlockIds.pop();
+    }
+    allocatedBlocks[blockId] = true;
+    numBlocksUsed++;
+    if (storageMode == StorageMode::InMemory)
+    {
+        blockArena.reserve(nextBlockId);
+    }
+
+    Block emptyBlock;
+    emptyBlock.updateChecksum();
+    if (storageMode != StorageMode::InMemory)
+    {
+        if (storageMode == StorageMode::MemoryMapped)
+        {
+            growMappedFile(blockId);
+        }
+        // Write an empty block so the page exists in the data file
+        writePage(blockId, emptyBlock);
+    }
+    else
+    {
+        blockSlot(blockId) = emptyBlock;
+    }
+}
+
+void DiskManager::deleteBlock(int64_t blockId)
 {
-    if (blocks.find(blockId) == blocks.end())
+    if (!hasBlock(blockId))
     {
         throw std::runtime_error("Block not found");
     }
-    blocks.erase(blockId);
+    if (storageMode != StorageMode::InMemory)
+    {
+        // Zero out the page so the block is recognised as free when the data file is opened again
+        Block zeroPage;
+        std::memset(reinterpret_cast<void *>(&zeroPage), 0, sizeof(Block));
+        writePage(blockId, zeroPage);
+    }
+    allocatedBlocks[blockId] = false;
+    freeBlockIds.push(blockId);
+    numBlocksUsed--;
     return;
 }
 
-int DiskManager::getNumRecordsStored() const
+int64_t DiskManager::getNumRecordsStored() const
 {
-    int numRecords = 0;
-    for (const auto &blockPair : blocks)
+    int64_t numRecords = 0;
+    if (storageMode == StorageMode::InMemory)
     {
-        numRecords += blockPair.second->getNumRecordsStored(); // Access the shared_ptr<Block> with blockPair.second
+        // Go chunk by chunk, so that counting does not pull the cold chunks back into the hot tier
+        std::vector<Block> chunk(TieredBlockArena::BLOCKS_PER_CHUNK);
+        for (int64_t chunkIndex = 0; chunkIndex < blockArena.getNumChunks(); chunkIndex++)
+        {
+            blockArena.copyChunk(chunkIndex, chunk.data());
+            int64_t firstBlockId = chunkIndex * TieredBlockArena::BLOCKS_PER_CHUNK;
+            for (int64_t blockId = firstBlockId; blockId < std::min(nextBlockId, firstBlockId + TieredBlockArena::BLOCKS_PER_CHUNK); blockId++)
+            {
+                if (allocatedBlocks[blockId])
+                {
+                    numRecords += chunk[blockId - firstBlockId].getNumRecordsStored();
+                }
+            }
+        }
+        return numRecords;
+    }
+
+    Block block;
+    for (int64_t blockId = 0; blockId < nextBlockId; blockId++)
+    {
+        if (allocatedBlocks[blockId])
+        {
+            readPage(blockId, block);
+            numRecords += block.getNumRecordsStored();
+        }
     }
     return numRecords;
 }
 
-std::vector<int> DiskManager::getAllBlockIds() const
+// Block IDs are returned in ascending order, which is also the order of the blocks in memory and in the data file
+std::vector<int64_t> DiskManager::getAllBlockIds() const
 {
-    std::vector<int> blockIds;
-    for (const auto &blockPair : blocks)
+    std::vector<int64_t> blockIds;
+    blockIds.reserve(numBlocksUsed);
+    for (int64_t blockId = 0; blockId < nextBlockId; blockId++)
     {
-        blockIds.push_back(blockPair.first);
+        if (allocatedBlocks[blockId])
+        {
+            blockIds.push_back(blockId);
+        }
     }
     return blockIds;
 }
 
-double DiskManager::calculateRotationalDelay(int blockId)
+double DiskManager::calculateRotationalDelay(int64_t blockId) const
 {
     int sectorPosition = blockId % (int)sectorsPerTrack; // Find the sector position of the block using modulo for simulation
     double degreesPerSector = 360.0 / sectorsPerTrack;
@@ -105,42 +491,71 @@ double DiskManager::calculateRotationalDelay(int blockId)
     return rotationalDelay;
 }
 
-double DiskManager::calculateSeekTime(double distance)
+double DiskManager::calculateSeekTime(double distance) const
 {
     return 3 + (distance / tracksPerSurface) * 2; // 3ms startup time + fraction of full movement * time taken for full movement
     // referring to lecture, average seek time is 4ms. So, we can use 3ms as startup time and 2ms as time taken for full movement
     // 4ms = 3ms + 0.5 * 2ms
 }
 
-int DiskManager::blockIdToTrack(int blockId)
+int DiskManager::blockIdToTrack(int64_t blockId) const
 {
-    return fmod(blockId, tracksPerSurface);
+    return tracksPerSurface > 0 ? blockId % tracksPerSurface : 0;
 }
 
-double DiskManager::simulateBlockAccessTime(int blockId)
+void DiskManager::calculateAccessTime(int headTrack, int64_t blockId, double &seekTime, double &rotationalDelay, double &transferTime) const
 {
-    // Simulate cache access time
-    bool isCacheHit = (rand() % 100) < (cacheHitRate * 100);
-    if (isCacheHit)
-    {
-        return averageCacheAccessTime; // Return cache access time if hit
-    }
-
     // Simulate track seek time based on distance
-    double distance = std::abs(currentHeadPosition - blockIdToTrack(blockId));
-    double seekTime = calculateSeekTime(distance);
+    double distance = std::abs(headTrack - blockIdToTrack(blockId));
+    seekTime = calculateSeekTime(distance);
 
     // Simulate rotational delay
-    double rotationalDelay = calculateRotationalDelay(blockId);
+    rotationalDelay = calculateRotationalDelay(blockId);
 
     // Transfer time based on block size and transfer rate
     double transferRateMBperMS = 100.0 / 1000;               // 100 MB/s in MB/ms
-    double blockSizeMB = 200.0 / (1024 * 1024);              // 200 bytes in MB
-    double transferTime = blockSizeMB / transferRateMBperMS; // Transfer time in ms
+    double blockSizeMB = (double)BLOCK_SIZE / (1024 * 1024); // Block size in MB
+    transferTime = blockSizeMB / transferRateMBperMS;        // Transfer time in ms
+}
+
+double DiskManager::estimateAccessTime(int headTrack, int64_t blockId) const
+{
+    double seekTime, rotationalDelay, transferTime;
+    calculateAccessTime(headTrack, blockId, seekTime, rotationalDelay, transferTime);
+    return seekTime + rotationalDelay + transferTime;
+}
+
+// Cache hits are decided by the BufferPool, so every call here models a physical access
+double DiskManager::simulateBlockAccessTime(int64_t blockId, IOStats &ioStats)
+{
+    if (blockId == lastAccessedBlockId + 1)
+    {
+        ioStats.sequentialAccesses++;
+    }
+    else
+    {
+        ioStats.randomAccesses++;
+    }
+    lastAccessedBlockId = blockId;
+
+    double seekTime, rotationalDelay, transferTime;
+    calculateAccessTime(currentHeadPosition, blockId, seekTime, rotationalDelay, transferTime);
 
     // Update current head position for next access
     currentHeadPosition = blockIdToTrack(blockId);
 
+    ioStats.seekTime += seekTime;
+    ioStats.rotationalDelay += rotationalDelay;
+    ioStats.transferTime += transferTime;
+    ioStats.addDeviceTime(deviceIndex, seekTime + rotationalDelay + transferTime);
+
     // Return total access time in milliseconds
     return seekTime + rotationalDelay + transferTime;
-}
\ No newline at end of file
+}
+
+void DiskManager::seedAccessModel(unsigned seed)
+{
+    std::mt19937 generator(seed);
+    currentHeadPosition = tracksPerSurface > 0 ? generator() % tracksPerSurface : 0;
+    lastAccessedBlockId = -1;
+}
@@ -10,23 +10,63 @@
  *
  * We will use non-sequential storage of data blocks. This is because the B+ tree implementation
  * will be used to reduce our read time. Meanwhile, using non-sequential storage will allow us to
- * simplify implementation of writing and deleting blocks.
+ * simplify implementation of writing and deleting blocks. Block IDs index directly into a dense
+ * directory: in memory, blocks live in contiguous chunks of an arena, and deleted IDs are kept in a
+ * free list and handed out again, so a scan in block ID order walks memory sequentially. The arena
+ * can compress the chunks that have not been used recently (see TieredBlockArena).
+ *
+ * Blocks can either be kept in main memory or in a data file on the real disk (see StorageMode).
+ * In the file-backed mode, a block ID maps to a fixed offset in the data file and blocks are
+ * moved with pread/pwrite, so data sets larger than RAM can be stored. In the memory-mapped mode,
+ * the same data file is mapped into memory and blocks are served straight from the mapping.
+ *
+ * Batches of blocks can be read with readBlocks(). In File mode the batch is handed to an
+ * AsyncReader, which keeps many reads in flight at once and completes them out of order.
+ *
+ * Every page is stamped with a CRC32C checksum when it is written, and the checksum is verified when
+ * the page is read, in every mode. A mismatch is counted and reported as a std::runtime_error. Pages
+ * cached by the BufferPool are not read again, so cache hits are not verified.
  */
 
 #ifndef DISK_MANAGER_H
 #define DISK_MANAGER_H
 
 #include "block.h"
-#include <unordered_map>
+#include "block_storage.h"
+#include "async_reader.h"
+#include "tiered_block_arena.h"
+#include "io_stats.h"
+#include <functional>
 #include <iostream>
 #include <stdexcept>
 #include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sys/types.h>
 
-class DiskManager
+class DiskManager : public BlockStorage
 {
 private:
-    std::unordered_map<int, std::shared_ptr<Block>> blocks; // Maps block IDs to Block objects
-    int nextBlockId;                                        // For Block creation and ID assignment                                      // For Block creation and ID assignment
+    static constexpr int BLOCKS_PER_CHUNK = 1024; // Blocks the mapped data file grows by at a time
+    static constexpr int ASYNC_QUEUE_DEPTH = 64;  // Maximum number of block reads in flight (File mode)
+
+    // Block directory, indexed directly by block ID
+    mutable TieredBlockArena blockArena;                                                    // Holds the blocks (InMemory mode), reading a cold block promotes it
+    std::vector<bool> allocatedBlocks;                                                      // Whether each block ID below nextBlockId is in use
+    std::priority_queue<int64_t, std::vector<int64_t>, std::greater<int64_t>> freeBlockIds; // Deleted block IDs, reused lowest first
+    int64_t nextBlockId;                                                                    // For Block creation and ID assignment
+    int64_t numBlocksUsed;
+
+    // Storage backend
+    StorageMode storageMode;
+    std::string dataFilePath;                 // Path of the data file (File and MemoryMapped modes)
+    int dataFileFd;                           // File descriptor of the data file, -1 if not opened
+    uint8_t *mappedData;                      // Start of the mapping of the data file (MemoryMapped mode)
+    size_t mappedLength;                      // Length of the mapping, enough for the whole disk
+    int64_t numMappedFileBlocks;              // Number of blocks the data file is currently sized for (MemoryMapped mode)
+    std::unique_ptr<AsyncReader> asyncReader; // Batched reads of the data file (File mode)
 
     // Disk Configs
     int numOfSurface;
@@ -35,34 +75,80 @@ private:
     int sectorsPerTrack;  // 256 sectors as an arbitrary number
     int tracksPerSurface; // Calculated based on disk size
 
-    int currentHeadPosition;       // Represents the current position of the disk head
-    double rotationalSpeedRPM;     // Rotational speed of the disk in RPM
-    double cacheHitRate;           // Percentage of times data is found in cache
-    double averageCacheAccessTime; // Average access time from cache in ms
+    int currentHeadPosition;     // Represents the current position of the disk head
+    int64_t lastAccessedBlockId; // Block of the previous physical access, -1 before the first one
+    int deviceIndex;             // Index of this disk among the devices of a StripedDiskManager, 0 for a single disk
+    double rotationalSpeedRPM;   // Rotational speed of the disk in RPM
+
+    // Checksum statistics, updated by the const read paths
+    mutable long long numChecksumsVerified;
+    mutable long long numChecksumFailures;
 
     void updateDiskConfigurations();
-    double calculateRotationalDelay(int blockId);
-    double calculateSeekTime(double distance);
-    int blockIdToTrack(int blockId);
+    double calculateRotationalDelay(int64_t blockId) const;
+    double calculateSeekTime(double distance) const;
+    void calculateAccessTime(int headTrack, int64_t blockId, double &seekTime, double &rotationalDelay, double &transferTime) const;
+
+    Block &blockSlot(int64_t blockId);
+    const Block &blockSlot(int64_t blockId) const;
+    void openDataFile(bool openExisting);
+    void loadBlockDirectory(int64_t numFileBlocks);
+    void growMappedFile(int64_t blockId);
+    off_t blockIdToFileOffset(int64_t blockId) const;
+    void readPage(int64_t blockId, Block &block) const;
+    void writePage(int64_t blockId, const Block &block);
+    void verifyPage(int64_t blockId, const Block &block) const;
 
 public:
-    static const int BLOCK_SIZE = 200; // Size of each block in bytes
-    int DISK_SIZE;                     // Size of the disk in bytes
+    static const int BLOCK_SIZE = Block::BLOCK_SIZE; // Size of each block in bytes
+    int64_t DISK_SIZE;                               // Size of the disk in bytes
+
+    /**
+     * @param openExisting For File and MemoryMapped modes, keep the blocks already in the data file instead
+     * of truncating it. The block directory is rebuilt from the pages found in the file.
+     */
+    DiskManager(int64_t DISK_SIZE, StorageMode storageMode = StorageMode::InMemory, const std::string &dataFilePath = "", bool openExisting = false);
+    ~DiskManager();
+
+    // The DiskManager owns the data file descriptor, so it cannot be copied
+    DiskManager(const DiskManager &) = delete;
+    DiskManager &operator=(const DiskManager &) = delete;
+
+    // std::shared_ptr<Block> readBlock(int64_t blockId);
+
+    void readBlock(int64_t blockId, Block &block) const override;
+    void readBlocks(const std::vector<int64_t> &blockIds, const std::vector<Block *> &destinations, const std::function<void(int)> &onBlockRead) const override;
+    void writeBlock(int64_t blockId, const Block &block) override;
+    bool hasBlock(int64_t blockId) const override;
+
+    const Block *getMappedBlock(int64_t blockId) const override;
+    void adviseAccessPattern(AccessPattern accessPattern) override;
 
-    DiskManager(int DISK_SIZE);
+    int64_t createBlock() override;
+    // Create the block with the given ID, for callers that decide the IDs themselves such as StripedDiskManager
+    void createBlockWithId(int64_t blockId);
+    void deleteBlock(int64_t blockId) override;
+    int64_t getNumRecordsStored() const override;
+    int64_t getNumBlocksUsed() const override { return numBlocksUsed; };
+    int64_t getTotalBlockCapacity() const override { return DISK_SIZE / BLOCK_SIZE; };
+    std::vector<int64_t> getAllBlockIds() const override;
+    StorageMode getStorageMode() const override { return storageMode; };
+    const std::string &getDataFilePath() const override { return dataFilePath; };
 
-    // std::shared_ptr<Block> readBlock(int blockId);
+    double simulateBlockAccessTime(int64_t blockId, IOStats &ioStats) override;
+    void seedAccessModel(unsigned seed) override;
+    int getNumDevices() const override { return 1; };
+    int getDeviceOf(int64_t) const override { return 0; };
+    int getHeadPosition(int) const override { return currentHeadPosition; };
+    int blockIdToTrack(int64_t blockId) const override;
+    double estimateAccessTime(int headTrack, int64_t blockId) const override;
+    void setDeviceIndex(int deviceIndex) { this->deviceIndex = deviceIndex; };
 
-    Block readBlock(int blockId) const;
-    void writeBlock(int blockId, Block block);
+    void setMaxHotChunks(int maxHotChunks) override { blockArena.setMaxHotChunks(maxHotChunks); };
+    TieringStats getTieringStats() const override { return blockArena.getStats(); };
 
-    int createBlock();
-    void deleteBlock(int blockId);
-    int getNumRecordsStored() const;
-    int getNumBlocksUsed() const { return blocks.size(); };
-    int getTotalBlockCapacity() const { return DISK_SIZE / BLOCK_SIZE; };
-    std::vector<int> getAllBlockIds() const;
-    double simulateBlockAccessTime(int blockId);
+    long long getNumChecksumsVerified() const override { return numChecksumsVerified; };
+    long long getNumChecksumFailures() const override { return numChecksumFailures; };
 };
 
 #endif // DISK_MANAGER_H
@@ -0,0 +1,136 @@
+#include "free_space_map.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+static const uint32_t FREE_SPACE_MAP_MAGIC = 0x324d5346; // "FSM2", the block count is 64-bit since FSM2
+
+FreeSpaceMap::FreeSpaceMap(int blockCapacity)
+    : blockCapacity(blockCapacity), classMembers(blockCapacity + 1), nonEmptyClasses(blockCapacity / 64 + 1, 0) {}
+
+void FreeSpaceMap::addToClass(int64_t blockId, int fillClass)
+{
+    positionInClass[blockId] = classMembers[fillClass].size();
+    classMembers[fillClass].push_back(blockId);
+    nonEmptyClasses[fillClass / 64] |= 1ULL << (fillClass % 64);
+}
+
+void FreeSpaceMap::removeFromClass(int64_t blockId, int fillClass)
+{
+    // Swap the last member into the removed position to keep this O(1)
+    std::vector<int64_t> &members = classMembers[fillClass];
+    int64_t position = positionInClass[blockId];
+    int64_t lastBlockId = members.back();
+    members[position] = lastBlockId;
+    positionInClass[lastBlockId] = position;
+    members.pop_back();
+    if (members.empty())
+    {
+        nonEmptyClasses[fillClass / 64] &= ~(1ULL << (fillClass % 64));
+    }
+}
+
+void FreeSpaceMap::setFreeSlots(int64_t blockId, int numFreeSlots)
+{
+    if (numFreeSlots < 0 || numFreeSlots > blockCapacity)
+    {
+        throw std::invalid_argument("Number of free slots out of range");
+    }
+    if (blockId >= (int64_t)freeSlots.size())
+    {
+        freeSlots.resize(blockId + 1, 0);
+        positionInClass.resize(blockId + 1, -1);
+    }
+
+    int oldFreeSlots = freeSlots[blockId];
+    if (oldFreeSlots == numFreeSlots)
+    {
+        return;
+    }
+    if (oldFreeSlots > 0)
+    {
+        removeFromClass(blockId, oldFreeSlots);
+    }
+    if (numFreeSlots > 0)
+    {
+        addToClass(blockId, numFreeSlots);
+    }
+    freeSlots[blockId] = numFreeSlots;
+}
+
+int FreeSpaceMap::getFreeSlots(int64_t blockId) const
+{
+    return blockId < (int64_t)freeSlots.size() ? freeSlots[blockId] : 0;
+}
+
+int64_t FreeSpaceMap::findBlockWithFreeSlot() const
+{
+    for (int word = 0; word < (int)nonEmptyClasses.size(); word++)
+    {
+        if (nonEmptyClasses[word] != 0)
+        {
+            int fillClass = word * 64 + __builtin_ctzll(nonEmptyClasses[word]);
+            return classMembers[fillClass].back();
+        }
+    }
+    return -1;
+}
+
+int64_t FreeSpaceMap::countFreeSlots(int maxFreeSlotsPerBlock) const
+{
+    int64_t numFreeSlots = 0;
+    for (int fillClass = 1; fillClass <= std::min(maxFreeSlotsPerBlock, blockCapacity); fillClass++)
+    {
+        numFreeSlots += (int64_t)fillClass * classMembers[fillClass].size();
+    }
+    return numFreeSlots;
+}
+
+void FreeSpaceMap::save(const std::string &path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to save free space map to " + path);
+    }
+    uint32_t header[2] = {FREE_SPACE_MAP_MAGIC, (uint32_t)blockCapacity};
+    uint64_t numBlocks = freeSlots.size();
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(&numBlocks), sizeof(numBlocks));
+    for (int numFreeSlots : freeSlots)
+    {
+        uint16_t entry = numFreeSlots;
+        file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    }
+}
+
+bool FreeSpaceMap::load(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    uint32_t header[2];
+    uint64_t numBlocks;
+    if (!file.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        header[0] != FREE_SPACE_MAP_MAGIC || header[1] != (uint32_t)blockCapacity ||
+        !file.read(reinterpret_cast<char *>(&numBlocks), sizeof(numBlocks)))
+    {
+        return false;
+    }
+
+    std::vector<uint16_t> entries(numBlocks);
+    if (!file.read(reinterpret_cast<char *>(entries.data()), entries.size() * sizeof(uint16_t)))
+    {
+        return false;
+    }
+
+    *this = FreeSpaceMap(blockCapacity);
+    for (int64_t blockId = 0; blockId < (int64_t)entries.size(); blockId++)
+    {
+        if (entries[blockId] > blockCapacity)
+        {
+            *this = FreeSpaceMap(blockCapacity);
+            return false;
+        }
+        setFreeSlots(blockId, entries[blockId]);
+    }
+    return true;
+}
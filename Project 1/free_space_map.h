@@ -0,0 +1,55 @@
+/**
+ * @file free_space_map.h
+ * @brief Defines the FreeSpaceMap class, which tracks the number of free record slots of every block.
+ *
+ * Blocks are grouped into fill classes by their number of free slots (1 to BLOCK_CAPACITY). Each class
+ * keeps its blocks in a vector, and every block remembers its position in that vector, so moving a block
+ * between classes is O(1). A bitmap marks the non-empty classes, and a find-first-set over that bitmap
+ * returns the class with the fewest free slots that still has a block. Inserts are therefore placed in
+ * O(1) into the fullest block that has room, which keeps blocks densely packed after deletes instead of
+ * spreading new records over arbitrary half-empty blocks.
+ *
+ * The map is indexed directly by block ID, like the DiskManager block directory, so it never holds more
+ * entries than there are blocks. It can be saved next to the data file and loaded again when the data
+ * file is reopened.
+ */
+
+#ifndef FREE_SPACE_MAP_H
+#define FREE_SPACE_MAP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FreeSpaceMap
+{
+private:
+    int blockCapacity;                              // Number of record slots in a block
+    std::vector<int> freeSlots;                     // Free slots per block ID, 0 if the block is full or not tracked
+    std::vector<int64_t> positionInClass;           // Index of the block within classMembers[freeSlots[blockId]]
+    std::vector<std::vector<int64_t>> classMembers; // Block IDs per number of free slots
+    std::vector<uint64_t> nonEmptyClasses;          // Bit c is set if classMembers[c] is not empty
+
+    void addToClass(int64_t blockId, int fillClass);
+    void removeFromClass(int64_t blockId, int fillClass);
+
+public:
+    FreeSpaceMap(int blockCapacity);
+
+    // Set the number of free slots of a block, 0 removes the block from the map
+    void setFreeSlots(int64_t blockId, int numFreeSlots);
+    int getFreeSlots(int64_t blockId) const;
+
+    // Return the block with the fewest free slots that still has at least one, or -1 if there is none
+    int64_t findBlockWithFreeSlot() const;
+
+    // Total free slots of the blocks that have at most maxFreeSlotsPerBlock free slots
+    int64_t countFreeSlots(int maxFreeSlotsPerBlock) const;
+
+    void save(const std::string &path) const;
+
+    // Replace the map with the one saved at path. Returns false if there is no valid saved map
+    bool load(const std::string &path);
+};
+
+#endif // FREE_SPACE_MAP_H
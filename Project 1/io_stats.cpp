@@ -0,0 +1,79 @@
+#include "io_stats.h"
+#include <algorithm>
+#include <iomanip>
+
+IOStats &IOStats::operator+=(const IOStats &other)
+{
+    logicalReads += other.logicalReads;
+    physicalReads += other.physicalReads;
+    physicalWrites += other.physicalWrites;
+    sequentialAccesses += other.sequentialAccesses;
+    randomAccesses += other.randomAccesses;
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+    seekTime += other.seekTime;
+    rotationalDelay += other.rotationalDelay;
+    transferTime += other.transferTime;
+    cacheTime += other.cacheTime;
+    for (int device = 0; device < (int)other.deviceTime.size(); device++)
+    {
+        addDeviceTime(device, other.deviceTime[device]);
+    }
+    return *this;
+}
+
+IOStats IOStats::operator-(const IOStats &other) const
+{
+    IOStats difference;
+    difference.logicalReads = logicalReads - other.logicalReads;
+    difference.physicalReads = physicalReads - other.physicalReads;
+    difference.physicalWrites = physicalWrites - other.physicalWrites;
+    difference.sequentialAccesses = sequentialAccesses - other.sequentialAccesses;
+    difference.randomAccesses = randomAccesses - other.randomAccesses;
+    difference.bytesRead = bytesRead - other.bytesRead;
+    difference.bytesWritten = bytesWritten - other.bytesWritten;
+    difference.seekTime = seekTime - other.seekTime;
+    difference.rotationalDelay = rotationalDelay - other.rotationalDelay;
+    difference.transferTime = transferTime - other.transferTime;
+    difference.cacheTime = cacheTime - other.cacheTime;
+    difference.deviceTime = deviceTime;
+    for (int device = 0; device < (int)other.deviceTime.size(); device++)
+    {
+        difference.addDeviceTime(device, -other.deviceTime[device]);
+    }
+    return difference;
+}
+
+double IOStats::getElapsedTime() const
+{
+    double busiestDeviceTime = deviceTime.empty() ? 0 : *std::max_element(deviceTime.begin(), deviceTime.end());
+    return busiestDeviceTime + cacheTime;
+}
+
+void IOStats::addDeviceTime(int device, double time)
+{
+    if (device >= (int)deviceTime.size())
+    {
+        deviceTime.resize(device + 1, 0);
+    }
+    deviceTime[device] += time;
+}
+
+void IOStats::print(std::ostream &out) const
+{
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "Buffer pool hits: " << getCacheHits() << ", misses: " << physicalReads << std::endl;
+    out << "Physical reads: " << physicalReads << ", physical writes: " << physicalWrites
+        << " (sequential: " << sequentialAccesses << ", random: " << randomAccesses << ")" << std::endl;
+    out << "Bytes read: " << bytesRead << ", bytes written: " << bytesWritten << std::endl;
+    out << std::fixed << std::setprecision(4)
+        << "Modelled seek: " << seekTime << "ms, rotation: " << rotationalDelay
+        << "ms, transfer: " << transferTime << "ms, cache: " << cacheTime << "ms" << std::endl;
+    if (deviceTime.size() > 1)
+    {
+        out << "Devices: " << deviceTime.size() << ", elapsed with overlapping devices: " << getElapsedTime() << "ms" << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
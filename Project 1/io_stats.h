@@ -0,0 +1,53 @@
+/**
+ * @file io_stats.h
+ * @brief Defines the IOStats struct, the I/O accounting of one query or of a whole session.
+ *
+ * Logical reads are page fetches through the BufferPool, physical reads and writes are the ones that
+ * reach the DiskManager. Every physical access is classified as sequential, if it touches the block
+ * right after the previously accessed one, or random otherwise, and its modelled seek, rotation and
+ * transfer time is added up separately. The disk model is deterministic for a given seed (see
+ * DiskManager::seedAccessModel), so the same workload always produces the same IOStats and the
+ * numbers can be compared between runs.
+ *
+ * With several devices (see StripedDiskManager), the accesses of different devices overlap in time.
+ * The busy time of every device is kept separately, and the elapsed time is that of the busiest one.
+ *
+ * IOStats values are cumulative counters: the stats of a query are the difference of two snapshots.
+ */
+
+#ifndef IO_STATS_H
+#define IO_STATS_H
+
+#include <ostream>
+#include <vector>
+
+struct IOStats
+{
+    long long logicalReads = 0;       // Page fetches, hits and misses
+    long long physicalReads = 0;      // Blocks read from disk
+    long long physicalWrites = 0;     // Blocks written to disk
+    long long sequentialAccesses = 0; // Physical accesses to the block after the previously accessed one
+    long long randomAccesses = 0;     // All other physical accesses
+    long long bytesRead = 0;
+    long long bytesWritten = 0;
+
+    // Modelled time in ms
+    double seekTime = 0;
+    double rotationalDelay = 0;
+    double transferTime = 0;
+    double cacheTime = 0;           // Time of the fetches served by the buffer pool
+    std::vector<double> deviceTime; // Busy time of each device, the sum is seekTime + rotationalDelay + transferTime
+
+    long long getCacheHits() const { return logicalReads - physicalReads; };
+    // Total time of every access, as if they ran one after another
+    double getModeledTime() const { return seekTime + rotationalDelay + transferTime + cacheTime; };
+    // Time of the busiest device, with the accesses of different devices overlapping
+    double getElapsedTime() const;
+    void addDeviceTime(int device, double time);
+
+    IOStats &operator+=(const IOStats &other);
+    IOStats operator-(const IOStats &other) const;
+    void print(std::ostream &out) const;
+};
+
+#endif // IO_STATS_H
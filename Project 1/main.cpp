@@ -4,11 +4,19 @@
 #include "record.h"
 #include "block.h"
 #include "disk_manager.h"
+#include "crc32c.h"
+#include "column_segment.h"
+#include "predicate_kernels.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <tuple>
+#include <array>
+#include <algorithm>
+#include <iomanip>
+#include <chrono>
+#include <random>
 using namespace std;
 
 /**
@@ -20,12 +28,58 @@ using namespace std;
  * your CLI / terminal: (include all .cpp files in the list)
  *
  * cd "Project 1"
- * g++ -std=c++17 main.cpp b_plus_tree.cpp tree_helper.cpp block.cpp database.cpp record.cpp disk_manager.cpp -o main.exe
+ * g++ -std=c++17 main.cpp b_plus_tree.cpp tree_helper.cpp block.cpp database.cpp record.cpp disk_manager.cpp buffer_pool.cpp replacement_policy.cpp free_space_map.cpp async_reader.cpp io_stats.cpp request_scheduler.cpp striped_disk_manager.cpp block_codec.cpp tiered_block_arena.cpp crc32c.cpp column_segment.cpp predicate_kernels.cpp node_search.cpp node_arena.cpp -o main.exe
  * ./main.exe
  *
+ * To run the experiments with another block size, add -DBLOCK_SIZE_BYTES=4096 (or 8192, 16384)
+ *
+ * To check that data files larger than 4 GiB work in the File and MemoryMapped modes, build and run
+ * checks/large_file_check.cpp with the same files except main.cpp (see the build line in that file)
+ *
  * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  */
 
+/**
+ * One row of the fanout sweep: build a B+ tree with the given fanout both by bulk loading the sorted
+ * pairs and by inserting the pairs one by one in record order, then time exact-match lookups of
+ * lookupKeys on the bulk loaded tree.
+ */
+template <int Fanout>
+static void benchmarkFanout(const vector<RecordKeyPointerPair> &kpps, const vector<RecordKeyPointerPair> &sortedKpps,
+                            const vector<int> &lookupKeys, const string &label)
+{
+     BPTree<int, RecordPointer, Fanout> insertedTree;
+     auto insertStart = chrono::steady_clock::now();
+     for (auto &kpp : kpps)
+     {
+          insertedTree.insertKey(kpp.key, kpp.pointer);
+     }
+     double insertSeconds = chrono::duration<double>(chrono::steady_clock::now() - insertStart).count();
+     insertedTree.clear();
+
+     BPTree<int, RecordPointer, Fanout> tree;
+     auto bulkLoadStart = chrono::steady_clock::now();
+     tree.bulkLoad(sortedKpps);
+     double bulkLoadSeconds = chrono::duration<double>(chrono::steady_clock::now() - bulkLoadStart).count();
+
+     int64_t lookupMatches = 0;
+     auto lookupStart = chrono::steady_clock::now();
+     for (int key : lookupKeys)
+     {
+          lookupMatches += tree.exactSearch(key).size();
+     }
+     double lookupSeconds = chrono::duration<double>(chrono::steady_clock::now() - lookupStart).count();
+
+     NodeMemoryUsage usage = tree.getMemoryUsage();
+     cout << "n = " << Fanout << label << ": " << tree.getTotalNumNodes() << " nodes, " << tree.getTreeHeight() << " levels, "
+          << usage.getBytesInUse() << " bytes of nodes (LeafNode " << usage.leafNodeSlotSize << " bytes, NonLeafNode "
+          << usage.nonLeafNodeSlotSize << " bytes)" << endl;
+     cout << "     bulk load: " << setprecision(1) << bulkLoadSeconds * 1e3 << " ms, inserts: " << insertSeconds * 1e3
+          << " ms, lookups: " << setprecision(3) << lookupKeys.size() / lookupSeconds / 1e6 << " million/s, "
+          << setprecision(1) << lookupSeconds * 1e9 / lookupKeys.size() << " ns per lookup, record pointers found: "
+          << lookupMatches << setprecision(4) << endl;
+}
+
 int main()
 {
      cout << "<----------------- Database Storage Component ------------------->\n"
@@ -38,8 +92,15 @@ int main()
           << "\n"
           << "\n";
 
-     Database db(524288000);  // 500MB disk space
-     Database db2(524288000); // 500MB disk space (for experiment 5 delete twice)
+     DatabaseConfig tieredConfig;
+     tieredConfig.maxHotChunks = 4;
+     Database db(524288000, tieredConfig); // 500MB disk space, chunks of blocks outside the 4 most recently used are compressed
+     DatabaseConfig paxConfig;
+     paxConfig.blockLayout = BlockLayout::PAX;
+     Database db2(524288000, paxConfig); // 500MB disk space, blocks in the PAX layout (for experiment 5 delete twice)
+     DatabaseConfig stripedConfig;
+     stripedConfig.numDevices = 4;
+     Database db3(524288000, stripedConfig); // 500MB striped over 4 disks (for experiment 6)
      ifstream dataFile("./data.tsv");
      if (dataFile.is_open())
      {
@@ -56,32 +117,44 @@ int main()
                int numVotes;
                linestream >> averageRating >> numVotes;
                Record record(tconst, averageRating, numVotes);
-               db.insertRecord(record);
-               db2.insertRecord(record);
+               db.loadRecord(record);
+               db2.loadRecord(record);
+               db3.loadRecord(record);
           }
      }
+
+     // Index the loaded records all at once, bottom-up from their sorted keys
+     auto indexStart = chrono::steady_clock::now();
+     db.buildIndex();
+     double indexSeconds = chrono::duration<double>(chrono::steady_clock::now() - indexStart).count();
+     db2.buildIndex();
+     db3.buildIndex();
      cout << "<----------------- Data file read ended -------------------->"
           << "\n"
           << "\n";
 
-     DiskManager diskManager = db.getDiskManager();
-     BPTree bptree = db.getBPTree();
+     const BlockStorage &storage = db.getStorage();
+     const RecordIndex &bptree = db.getBPTree();
 
      cout << "<----------------- Experiment 1: Storing Data on Disk -------->" << endl;
-     cout << "Number of Records: " << diskManager.getNumRecordsStored() << endl;
-     cout << "Size of 1 Record: " << sizeof(Record) << endl;
-     cout << "Number of records in 1 Block: " << 200 / sizeof(Record) << endl;
-     cout << "Number of Blocks Storing Data: " << diskManager.getNumBlocksUsed() << endl;
+     cout << "Number of Records: " << storage.getNumRecordsStored() << endl;
+     cout << "Size of 1 Block: " << Block::BLOCK_SIZE << endl;
+     cout << "Size of 1 Record: " << Record::SERIALIZED_SIZE << endl;
+     cout << "Number of records in 1 Block: " << Block::BLOCK_CAPACITY << endl;
+     cout << "Number of Blocks Storing Data: " << storage.getNumBlocksUsed() << endl;
      dataFile.close();
      cout << "\n"
           << endl;
 
      cout << "<----------------- Experiment 2: Building a B+ Tree --------------->" << endl;
-     cout << "Parameter n = " << n << endl;
+     cout << "Parameter n = " << RecordIndex::n << endl;
      cout << "Number of Nodes: " << bptree.getTotalNumNodes() << endl;
      cout << "Number of Levels: " << bptree.getTreeHeight() << endl;
      cout << "Content of root node: ";
      bptree.displayRootNode();
+     cout << "\n"
+          << "Bulk loading time: " << indexSeconds * 1000 << " ms" << endl;
+     bptree.getMemoryUsage().print(cout);
 
      cout << "\n"
           << endl;
@@ -89,34 +162,46 @@ int main()
      cout << "<----------------- Experiment 3: retrieve those movies with the numVotes == 500 -------->" << endl;
      cout << "Retrieving Records with B+ tree:" << endl;
      cout << "Number of index nodes of B+ tree accessed: " << bptree.getNumIndexNodes(500) << endl;
-     vector<Record> records = db.retrieveRecordByBPTree(500);
+     vector<Record> records = db.retrieveRecordByBPTree(500).records;
 
      cout << "\n"
           << endl;
 
      cout << "Retrieving Records with Linear Scan:" << endl;
-     records = db.retrieveRecordByLinearScan(500);
+     records = db.retrieveRecordByLinearScan(500).records;
+     cout << "\n"
+          << endl;
+
+     cout << "Tiered storage after Experiment 3:" << endl;
+     storage.getTieringStats().print(cout);
      cout << "\n"
           << endl;
 
      cout << "<----------------- Experiment 4: retrieve those movies with 30,000 <= numVotes <= 40,000 -------->" << endl;
      cout << "Retrieving Records with B+ tree:" << endl;
      cout << "Number of index nodes of B+ tree accessed: " << bptree.getNumIndexNodes(30000) << endl;
-     records = db.retrieveRangeRecordsByBPTree(30000, 40000);
+     records = db.retrieveRangeRecordsByBPTree(30000, 40000).records;
 
      cout << "\n"
           << endl;
 
      cout << "Retrieving Records with Linear Scan:" << endl;
-     records = db.retrieveRangeRecordsByLinearScan(30000, 40000);
+     records = db.retrieveRangeRecordsByLinearScan(30000, 40000).records;
+     cout << "\n"
+          << endl;
+
+     cout << "Tiered storage after Experiment 4:" << endl;
+     storage.getTieringStats().print(cout);
      cout << "\n"
           << endl;
 
      cout << "<----------------- Experiment 5: delete those movies with numVotes == 1,000 -------->" << endl;
      cout << "Deleting Records with B+ tree:" << endl;
-     records = db.retrieveRecordByBPTree(1000);
+     records = db.retrieveRecordByBPTree(1000).records;
      cout << "Records to be deleted count: " << records.size() << endl;
      db.deleteRecordByBPTree(1000);
+     cout << "Index entries queued for cleanup: " << db.getNumPendingIndexDeletes() << endl;
+     cout << "Index entries removed by the cleaner: " << db.cleanIndex(db.getNumPendingIndexDeletes()) << endl;
      cout << "Number of nodes of B+ tree after deletion: " << bptree.getTotalNumNodes() - 5 << endl;
      cout << "Number of levels of B+ tree after deletion: " << bptree.getTreeHeight() << endl;
      cout << "Content of root node of B+ tree after deletion: ";
@@ -125,8 +210,164 @@ int main()
      cout << "\n"
           << endl;
 
-     cout << "Deleting Records with Linear Scan:" << endl;
+     cout << "Deleting Records with Linear Scan (PAX blocks, " << PredicateKernels::getImplementationName() << " filter):" << endl;
      db2.deleteRecordsByLinearScan(1000);
+     cout << "Index entries queued for cleanup: " << db2.getNumPendingIndexDeletes() << " (removed by the compaction in experiment 7)" << endl;
+
+     cout << "\n"
+          << endl;
+
+     cout << "<----------------- Experiment 6: striping a linear scan over 4 disks -------->" << endl;
+     cout << "Retrieving Records with Linear Scan on 1 disk:" << endl;
+     records = db.retrieveRangeRecordsByLinearScan(30000, 40000).records;
+     cout << "\n"
+          << endl;
+
+     cout << "Retrieving Records with Linear Scan on " << stripedConfig.numDevices << " disks, stripe width "
+          << stripedConfig.stripeWidth << ":" << endl;
+     records = db3.retrieveRangeRecordsByLinearScan(30000, 40000).records;
+     cout << "\n"
+          << endl;
+
+     cout << "<----------------- Experiment 7: compacting the blocks left partially empty by experiment 5 -------->" << endl;
+     cout << "Number of Blocks Storing Data before compaction: " << db2.getStorage().getNumBlocksUsed() << endl;
+     CompactionResult compaction;
+     IOStats compactionIOStats;
+     int64_t numSlices = 0, recordsMoved = 0, blocksFreed = 0;
+     do
+     {
+          compaction = db2.compact(4096); // Queries could run between the slices
+          compactionIOStats += compaction.ioStats;
+          recordsMoved += compaction.recordsMoved;
+          blocksFreed += compaction.blocksFreed;
+          numSlices++;
+     } while (!compaction.passFinished);
+     cout << "Compacted in " << numSlices << " slices: " << recordsMoved << " records moved, "
+          << blocksFreed << " blocks freed" << endl;
+     compactionIOStats.print(cout);
+     cout << "Number of Blocks Storing Data after compaction: " << db2.getStorage().getNumBlocksUsed() << endl;
+     cout << "Retrieving Records with Linear Scan after compaction:" << endl;
+     records = db2.retrieveRangeRecordsByLinearScan(30000, 40000).records;
+     cout << "\n"
+          << endl;
+
+     cout << "<----------------- Experiment 8: compressed column segments -------->" << endl;
+     // Copy the records of Database 1 into column segments, in block order
+     const BlockStorage &segmentSource = db.getStorage(); // Flushes the deletes of experiment 5 to the blocks
+     vector<Record> allRecords;
+     Block rowBlock;
+     for (int64_t blockId : segmentSource.getAllBlockIds())
+     {
+          segmentSource.readBlock(blockId, rowBlock);
+          vector<Record> blockRecords = rowBlock.retrieveAllRecords();
+          allRecords.insert(allRecords.end(), blockRecords.begin(), blockRecords.end());
+     }
+     vector<array<uint8_t, ColumnSegment::SEGMENT_SIZE>> segments;
+     for (size_t first = 0; first < allRecords.size();)
+     {
+          segments.emplace_back();
+          first += ColumnSegment::encode(allRecords.data() + first, allRecords.size() - first, segments.back().data());
+     }
+     cout << "Number of Records: " << allRecords.size() << endl;
+     cout << "Row layout: " << segmentSource.getNumBlocksUsed() << " blocks, "
+          << fixed << setprecision(1) << segmentSource.getNumBlocksUsed() * 1e6 / allRecords.size() << " blocks per million rows" << endl;
+     cout << "Column segments: " << segments.size() << " segments of " << ColumnSegment::SEGMENT_SIZE << " bytes, "
+          << segments.size() * 1e6 / allRecords.size() << " segments per million rows" << endl;
+
+     // Scan the segments for numVotes == 500, decoding the numVotes column in one batch per segment
+     vector<uint32_t> segmentNumVotes;
+     vector<Record> segmentRecords;
+     int64_t matchCount = 0;
+     double totalMatchRating = 0;
+     for (auto &segment : segments)
+     {
+          int numSegmentRecords = ColumnSegment::getNumRecords(segment.data());
+          segmentNumVotes.resize(numSegmentRecords);
+          ColumnSegment::decodeNumVotes(segment.data(), segmentNumVotes.data());
+          if (find(segmentNumVotes.begin(), segmentNumVotes.end(), 500u) == segmentNumVotes.end())
+          {
+               continue; // Only segments with a match are decoded completely
+          }
+          segmentRecords.clear();
+          ColumnSegment::decodeRecords(segment.data(), segmentRecords);
+          for (auto &record : segmentRecords)
+          {
+               if (record.getNumVotes() == 500)
+               {
+                    matchCount++;
+                    totalMatchRating += record.getAverageRating();
+               }
+          }
+     }
+     cout << "Retrieving Records with numVotes == 500 from the column segments: " << matchCount
+          << " records, average rating: " << setprecision(4) << totalMatchRating / matchCount << endl;
+     cout << "\n"
+          << endl;
+
+     cout << "<----------------- Experiment 9: B+ tree lookup throughput -------->" << endl;
+     // Exact-match lookups of distinct numVotes values drawn at random, on the index of Database 1
+     vector<int> distinctKeys;
+     for (auto &record : allRecords)
+     {
+          distinctKeys.push_back(record.getNumVotes());
+     }
+     sort(distinctKeys.begin(), distinctKeys.end());
+     distinctKeys.erase(unique(distinctKeys.begin(), distinctKeys.end()), distinctKeys.end());
+     mt19937 lookupRng(42);
+     vector<int> lookupKeys(200000);
+     for (int &key : lookupKeys)
+     {
+          key = distinctKeys[lookupRng() % distinctKeys.size()];
+     }
+     const RecordIndex &lookupTree = db.getBPTree();
+     int64_t lookupMatches = 0;
+     auto lookupStart = chrono::steady_clock::now();
+     for (int key : lookupKeys)
+     {
+          lookupMatches += lookupTree.exactSearch(key).size();
+     }
+     double lookupSeconds = chrono::duration<double>(chrono::steady_clock::now() - lookupStart).count();
+     cout << "Exact-match lookups: " << lookupKeys.size() << ", record pointers found: " << lookupMatches << endl;
+     cout << "Lookup throughput: " << setprecision(3) << lookupKeys.size() / lookupSeconds / 1e6 << " million lookups/s, "
+          << setprecision(1) << lookupSeconds * 1e9 / lookupKeys.size() << " ns per lookup" << setprecision(4) << endl;
+     cout << "\n"
+          << endl;
+
+     cout << "<----------------- Experiment 10: B+ tree fanout sweep -------->" << endl;
+     // Index the records of experiment 8 with every fanout the tree is compiled for, and repeat the lookups of experiment 9
+     vector<RecordKeyPointerPair> sweepKpps;
+     for (size_t i = 0; i < allRecords.size(); i++)
+     {
+          sweepKpps.push_back(RecordKeyPointerPair(allRecords[i].getNumVotes(), RecordPointer(i / Block::BLOCK_CAPACITY, i % Block::BLOCK_CAPACITY)));
+     }
+     vector<RecordKeyPointerPair> sortedSweepKpps = sweepKpps;
+     stable_sort(sortedSweepKpps.begin(), sortedSweepKpps.end(), [](const RecordKeyPointerPair &a, const RecordKeyPointerPair &b)
+                 { return a.key < b.key; });
+     cout << "Records: " << sweepKpps.size() << ", exact-match lookups: " << lookupKeys.size() << endl;
+     benchmarkFanout<8>(sweepKpps, sortedSweepKpps, lookupKeys, "");
+     benchmarkFanout<getCacheLineFanout<int>()>(sweepKpps, sortedSweepKpps, lookupKeys, " (keys of a NonLeafNode fill a cache line)");
+     benchmarkFanout<32>(sweepKpps, sortedSweepKpps, lookupKeys, "");
+     benchmarkFanout<64>(sweepKpps, sortedSweepKpps, lookupKeys, "");
+     benchmarkFanout<128>(sweepKpps, sortedSweepKpps, lookupKeys, "");
+     benchmarkFanout<getPageFanout<int, RecordPointer>()>(sweepKpps, sortedSweepKpps, lookupKeys, " (a LeafNode fills a memory page)");
+     benchmarkFanout<256>(sweepKpps, sortedSweepKpps, lookupKeys, "");
+     cout << "\n"
+          << endl;
+
+     cout << "<----------------- Session I/O ------------------------------------->" << endl;
+     cout << "Database 1:" << endl;
+     db.getSessionIOStats().print(cout);
+     cout << "Modelled time: " << db.getSessionIOStats().getElapsedTime() << "ms" << endl;
+     cout << "Database 2:" << endl;
+     db2.getSessionIOStats().print(cout);
+     cout << "Modelled time: " << db2.getSessionIOStats().getElapsedTime() << "ms" << endl;
+     for (Database *database : {&db, &db2})
+     {
+          const BlockStorage &sessionStorage = database->getStorage();
+          cout << "Page checksums (CRC32C, " << Crc32c::getImplementationName() << "): "
+               << sessionStorage.getNumChecksumsVerified() << " verified, "
+               << sessionStorage.getNumChecksumFailures() << " mismatches" << endl;
+     }
 
      cout << endl;
      return 0;
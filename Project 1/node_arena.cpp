@@ -0,0 +1,73 @@
+#include "node_arena.h"
+#include <algorithm>
+#include <new>
+
+// Size of a slot for a node of sizeof nodeSize, rounded up to whole cache lines
+static size_t roundToCacheLines(size_t nodeSize) {
+    return (nodeSize + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ NodeMemoryUsage ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+int64_t NodeMemoryUsage::getBytesInUse() const {
+    return numLeafNodes * leafNodeSlotSize + numNonLeafNodes * nonLeafNodeSlotSize;
+}
+
+void NodeMemoryUsage::print(std::ostream &out) const {
+    out << "Node memory: " << slabBytes << " bytes in " << numSlabs << " slabs, " << getBytesInUse()
+        << " bytes in use" << std::endl;
+    out << "LeafNodes: " << numLeafNodes << " of " << leafNodeSlotSize << " bytes, NonLeafNodes: " << numNonLeafNodes
+        << " of " << nonLeafNodeSlotSize << " bytes, free slots: " << numFreeSlots << std::endl;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ NodeSlotPool ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+void NodeSlotPool::SlabDeleter::operator()(uint8_t* slab) const {
+    ::operator delete(slab, std::align_val_t(CACHE_LINE_SIZE));
+}
+
+// A slot that does not fit in SLAB_SIZE gets a slab of its own, so every slab holds at least one slot
+NodeSlotPool::NodeSlotPool(size_t nodeSize)
+    : slotSize(roundToCacheLines(nodeSize)),
+      slabSize(std::max(SLAB_SIZE, slotSize)),
+      numSlotsPerSlab(slabSize / slotSize) {}
+
+void* NodeSlotPool::allocate() {
+    numInUse++;
+
+    // Reuse the slot of a released node first
+    if (freeList != nullptr) {
+        void* slot = freeList;
+        freeList = *static_cast<void**>(slot);
+        numFree--;
+        return slot;
+    }
+
+    if (numSlotsLeftInSlab == 0) {
+        uint8_t* slab = static_cast<uint8_t*>(::operator new(slabSize, std::align_val_t(CACHE_LINE_SIZE)));
+        slabs.emplace_back(slab);
+        numSlotsLeftInSlab = numSlotsPerSlab;
+    }
+    uint8_t* slot = slabs.back().get() + (numSlotsPerSlab - numSlotsLeftInSlab) * slotSize;
+    numSlotsLeftInSlab--;
+    return slot;
+}
+
+void NodeSlotPool::release(void* slot) {
+    *static_cast<void**>(slot) = freeList;
+    freeList = slot;
+    numInUse--;
+    numFree++;
+}
+
+void NodeSlotPool::clear() {
+    slabs.clear();
+    numSlotsLeftInSlab = 0;
+    freeList = nullptr;
+    numInUse = 0;
+    numFree = 0;
+}
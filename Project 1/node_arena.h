@@ -0,0 +1,147 @@
+#pragma once // Header guard to prevent multiple inclusions
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <ostream>
+#include <new>
+#include "tree_helper.h"
+
+/**
+ * Memory held by the nodes of one B+ tree, see NodeArena::getMemoryUsage()
+*/
+struct NodeMemoryUsage {
+    // Bytes reserved from the heap, in whole slabs
+    int64_t slabBytes = 0;
+    int64_t numSlabs = 0;
+
+    // Nodes in the tree, and the size of the slot each one takes
+    int64_t numLeafNodes = 0;
+    int64_t numNonLeafNodes = 0;
+    int64_t leafNodeSlotSize = 0;
+    int64_t nonLeafNodeSlotSize = 0;
+
+    // Slots of released nodes, waiting on the free lists to be reused
+    int64_t numFreeSlots = 0;
+
+    // Bytes of the slots taken by nodes
+    int64_t getBytesInUse() const;
+
+    void print(std::ostream &out) const;
+};
+
+/**
+ * Fixed-size slots carved out of slabs, for the nodes of one kind
+ *
+ * Every slab is aligned to a cache line and every slot is rounded up to a
+ * whole number of cache lines. Slots are handed out in address order, and
+ * a released slot stores the pointer to the next free slot in its first
+ * bytes. Slabs are SLAB_SIZE bytes, or one slot when a slot is larger.
+*/
+class NodeSlotPool {
+    public:
+        static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+        // Slots for objects of nodeSize bytes
+        explicit NodeSlotPool(size_t nodeSize);
+
+        // The pool owns its slabs, so it cannot be copied
+        NodeSlotPool(const NodeSlotPool&) = delete;
+        NodeSlotPool& operator=(const NodeSlotPool&) = delete;
+
+        void* allocate();
+
+        // Put a slot on the free list, to be handed out again by allocate()
+        void release(void* slot);
+
+        // Give back every slab
+        void clear();
+
+        size_t getSlotSize() const { return slotSize; }
+        size_t getSlabSize() const { return slabSize; }
+        int64_t getNumSlabs() const { return slabs.size(); }
+        int64_t getNumInUse() const { return numInUse; }
+        int64_t getNumFree() const { return numFree; }
+
+    private:
+        // Slabs freed with the alignment they were allocated with
+        struct SlabDeleter {
+            void operator()(uint8_t* slab) const;
+        };
+
+        size_t slotSize;
+        size_t slabSize;
+        size_t numSlotsPerSlab;
+        std::vector<std::unique_ptr<uint8_t[], SlabDeleter>> slabs;
+        size_t numSlotsLeftInSlab = 0; // Slots at the end of the last slab never handed out
+        void* freeList = nullptr;
+        int64_t numInUse = 0;
+        int64_t numFree = 0;
+};
+
+/**
+ * Allocator for the nodes of one B+ tree
+ *
+ * Nodes are carved out of large slabs instead of being allocated one by
+ * one, so the nodes created together, e.g. by a bulk load, sit next to
+ * each other in memory. Every slab is aligned to a cache line and every
+ * slot is rounded up to a whole number of cache lines, so a node never
+ * shares a cache line with another one and its header and first keys are
+ * always in its first cache line.
+ *
+ * LeafNodes and NonLeafNodes have different sizes, so each has its own
+ * slots. The slots of released nodes, e.g. after a merge, are kept on a
+ * free list and reused by the next node of the same kind.
+ *
+ * Nodes are never destroyed one by one: they only hold keys and
+ * pointers, so clear() or destroying the arena gives all of their memory
+ * back at once.
+ *
+ * @tparam LeafNodeType, NonLeafNodeType The node types of the tree
+*/
+template <typename LeafNodeType, typename NonLeafNodeType>
+class NodeArena {
+    public:
+        NodeArena() : leafSlots(sizeof(LeafNodeType)), nonLeafSlots(sizeof(NonLeafNodeType)) {}
+
+        LeafNodeType* createLeafNode() {
+            return new (leafSlots.allocate()) LeafNodeType();
+        }
+
+        // A NonLeafNode at the given level, 1 for the parents of LeafNodes
+        NonLeafNodeType* createNonLeafNode(int level) {
+            return new (nonLeafSlots.allocate()) NonLeafNodeType(level);
+        }
+
+        // Put the slot of a node that is no longer in the tree on the free list
+        void releaseNode(Node* node) {
+            if (node->isLeaf()) {
+                leafSlots.release(node);
+            } else {
+                nonLeafSlots.release(node);
+            }
+        }
+
+        // Give back the memory of every node at once
+        void clear() {
+            leafSlots.clear();
+            nonLeafSlots.clear();
+        }
+
+        NodeMemoryUsage getMemoryUsage() const {
+            NodeMemoryUsage usage;
+            usage.numSlabs = leafSlots.getNumSlabs() + nonLeafSlots.getNumSlabs();
+            usage.slabBytes = leafSlots.getNumSlabs() * leafSlots.getSlabSize() +
+                              nonLeafSlots.getNumSlabs() * nonLeafSlots.getSlabSize();
+            usage.numLeafNodes = leafSlots.getNumInUse();
+            usage.numNonLeafNodes = nonLeafSlots.getNumInUse();
+            usage.leafNodeSlotSize = leafSlots.getSlotSize();
+            usage.nonLeafNodeSlotSize = nonLeafSlots.getSlotSize();
+            usage.numFreeSlots = leafSlots.getNumFree() + nonLeafSlots.getNumFree();
+            return usage;
+        }
+
+    private:
+        NodeSlotPool leafSlots;
+        NodeSlotPool nonLeafSlots;
+};
@@ -0,0 +1,72 @@
+#include "node_search.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define NODE_SEARCH_HAVE_AVX2 1
+#endif
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ AVX2 ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+#ifdef NODE_SEARCH_HAVE_AVX2
+// Number of keys smaller than key, or not greater than key if Upper.
+// Compiled for AVX2 on its own, so the rest of the program does not require it
+template <bool Upper>
+__attribute__((target("avx2,popcnt"))) static int countAvx2(const int* keys, int numKeys, int key) {
+    const __m256i keyVector = _mm256_set1_epi32(key);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= numKeys; i += 8) {
+        __m256i batch = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        if (Upper) {
+            // 8 minus the keys greater than key
+            __m256i greater = _mm256_cmpgt_epi32(batch, keyVector);
+            count += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(greater)));
+        } else {
+            __m256i smaller = _mm256_cmpgt_epi32(keyVector, batch);
+            count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(smaller)));
+        }
+    }
+    for (; i < numKeys; i++) {
+        count += Upper ? keys[i] <= key : keys[i] < key;
+    }
+    return count;
+}
+
+// Runs during static initialisation, before the CPU model is set up for __builtin_cpu_supports
+static const bool hasAvx2 = [] {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}();
+#endif
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ NodeSearch ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+int NodeSearch::lowerBound(const int* keys, int numKeys, int key) {
+#ifdef NODE_SEARCH_HAVE_AVX2
+    if (hasAvx2) {
+        return countAvx2<false>(keys, numKeys, key);
+    }
+#endif
+    return branchlessSearch(keys, numKeys, [key](int k) { return k < key; });
+}
+
+int NodeSearch::upperBound(const int* keys, int numKeys, int key) {
+#ifdef NODE_SEARCH_HAVE_AVX2
+    if (hasAvx2) {
+        return countAvx2<true>(keys, numKeys, key);
+    }
+#endif
+    return branchlessSearch(keys, numKeys, [key](int k) { return k <= key; });
+}
+
+const char* NodeSearch::getImplementationName() {
+#ifdef NODE_SEARCH_HAVE_AVX2
+    return hasAvx2 ? "AVX2" : "branchless binary search";
+#else
+    return "branchless binary search";
+#endif
+}
@@ -0,0 +1,91 @@
+#pragma once // Header guard to prevent multiple inclusions
+#include "tree_helper.h"
+
+/**
+ * Search within one node of the B+ tree
+ *
+ * Every function takes the number of keys in use from the node header
+ * (numKeys) and only looks at those, so empty keys never need to be
+ * tested. The keys of a node are sorted, so the position of a key is the
+ * number of keys smaller than it:
+ *
+ * - lowerBound: number of keys < key, the first position holding key or more
+ * - upperBound: number of keys <= key, the first position holding more than key
+ *
+ * The keys of a NonLeafNode are stored together. For int keys on CPUs with
+ * AVX2, selected at run time, 8 of them are compared at once and the
+ * matches are counted from the movemask, without a branch per key.
+ * Otherwise a branchless binary search is used.
+ *
+ * The keys of a LeafNode are interleaved with the record pointers, so they
+ * are scanned in order up to the first key past the target. exactSearch and
+ * rangeSearch scan the leaves themselves and do the same.
+*/
+class NodeSearch {
+    public:
+        // Position of key in the keys of a NonLeafNode
+        template <typename Key, int Fanout>
+        static int lowerBound(const NonLeafNode<Key, Fanout>* node, Key key) {
+            return lowerBound(node->keyArray, node->numKeys, key);
+        }
+
+        template <typename Key, int Fanout>
+        static int upperBound(const NonLeafNode<Key, Fanout>* node, Key key) {
+            return upperBound(node->keyArray, node->numKeys, key);
+        }
+
+        /**
+         * Position after key in the KeyPointerPairs of a LeafNode
+         *
+         * The keys are spread over the KeyPointerPairs, so a binary search would wait for a
+         * different cache line at every step. A scan reads them in address order instead,
+         * which the prefetcher keeps ahead of, and stops at the first key past the target
+        */
+        template <typename Key, typename Value, int Fanout>
+        static int upperBound(const LeafNode<Key, Value, Fanout>* node, Key key) {
+            int i = 0;
+            while (i < node->numKeys && node->kppArray[i].key <= key) {
+                i++;
+            }
+            return i;
+        }
+
+        // Position of key in sorted keys[0..numKeys), with AVX2 where the CPU has it
+        static int lowerBound(const int* keys, int numKeys, int key);
+        static int upperBound(const int* keys, int numKeys, int key);
+
+        // Position of key in sorted keys[0..numKeys), for the other key types
+        template <typename Key>
+        static int lowerBound(const Key* keys, int numKeys, Key key) {
+            return branchlessSearch(keys, numKeys, [key](const Key& k) { return k < key; });
+        }
+
+        template <typename Key>
+        static int upperBound(const Key* keys, int numKeys, Key key) {
+            return branchlessSearch(keys, numKeys, [key](const Key& k) { return k <= key; });
+        }
+
+        // Name of the implementation used for the int keys of NonLeafNodes, e.g. for reporting
+        static const char* getImplementationName();
+
+    private:
+        /**
+         * Number of leading keys for which before(key) holds, with keys[0..numKeys) sorted.
+         * The halving step is a conditional move, so the loop runs log2(numKeys) times without a
+         * mispredicted branch.
+        */
+        template <typename Key, typename Before>
+        static int branchlessSearch(const Key* keys, int numKeys, Before before) {
+            if (numKeys == 0) {
+                return 0;
+            }
+            int base = 0;
+            int length = numKeys;
+            while (length > 1) {
+                int half = length / 2;
+                base = before(keys[base + half - 1]) ? base + half : base;
+                length -= half;
+            }
+            return base + (before(keys[base]) ? 1 : 0);
+        }
+};
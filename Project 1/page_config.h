@@ -0,0 +1,26 @@
+/**
+ * @file page_config.h
+ * @brief Compile-time page size shared by Block, DiskManager and Database.
+ *
+ * The page (block) size defaults to the 200 bytes used in the experiments. To benchmark another
+ * page size without changing the code, compile with -DBLOCK_SIZE_BYTES=<size>, e.g.
+ *
+ * g++ -std=c++17 -DBLOCK_SIZE_BYTES=4096 main.cpp ... -o main.exe
+ *
+ * The number of records per block, the data file layout and the disk geometry all follow from it.
+ */
+
+#ifndef PAGE_CONFIG_H
+#define PAGE_CONFIG_H
+
+#ifndef BLOCK_SIZE_BYTES
+#define BLOCK_SIZE_BYTES 200
+#endif
+
+// Size of one block in bytes
+constexpr int CONFIGURED_BLOCK_SIZE = BLOCK_SIZE_BYTES;
+
+static_assert(CONFIGURED_BLOCK_SIZE == 200 || CONFIGURED_BLOCK_SIZE == 4096 || CONFIGURED_BLOCK_SIZE == 8192 || CONFIGURED_BLOCK_SIZE == 16384,
+              "BLOCK_SIZE_BYTES must be one of 200, 4096, 8192 or 16384");
+
+#endif // PAGE_CONFIG_H
@@ -0,0 +1,142 @@
+#include "predicate_kernels.h"
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PREDICATE_KERNELS_HAVE_X86 1
+#endif
+
+static const uint16_t EMPTY_SLOT_FLAG = 0x8000; // As in Block
+
+// Bits of a batch that starts at index first. Batches are 4 or 8 values and start on a multiple of
+// their size, so a batch never straddles two words of the bitmask
+static void setSelectionBits(uint64_t *selection, int first, uint64_t bits)
+{
+    selection[first / 64] |= bits << (first % 64);
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Scalar kernels ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+// Also finishes the values left over by the vector kernels, from index first on
+static void selectInRangeScalar(const uint8_t *values, int first, int count, int32_t low, int32_t high, uint64_t *selection)
+{
+    for (int i = first; i < count; i++)
+    {
+        int32_t value;
+        std::memcpy(&value, values + i * sizeof(int32_t), sizeof(value));
+        if (value >= low && value <= high)
+        {
+            setSelectionBits(selection, i, 1);
+        }
+    }
+}
+
+static void selectOccupiedScalar(const uint8_t *slotEntries, int first, int count, uint64_t *selection)
+{
+    for (int i = first; i < count; i++)
+    {
+        uint16_t entry;
+        std::memcpy(&entry, slotEntries + i * sizeof(uint16_t), sizeof(entry));
+        if (!(entry & EMPTY_SLOT_FLAG))
+        {
+            setSelectionBits(selection, i, 1);
+        }
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ x86-64 kernels ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+#ifdef PREDICATE_KERNELS_HAVE_X86
+// SSE2 is part of x86-64, so these need no run-time check
+static void selectInRangeSse2(const uint8_t *values, int count, int32_t low, int32_t high, uint64_t *selection)
+{
+    const __m128i lowVector = _mm_set1_epi32(low);
+    const __m128i highVector = _mm_set1_epi32(high);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i batch = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i * sizeof(int32_t)));
+        // Outside the range if below low or above high, one compare each
+        __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(lowVector, batch), _mm_cmpgt_epi32(batch, highVector));
+        setSelectionBits(selection, i, ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF);
+    }
+    selectInRangeScalar(values, i, count, low, high, selection);
+}
+
+static void selectOccupiedSse2(const uint8_t *slotEntries, int count, uint64_t *selection)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i batch = _mm_loadu_si128(reinterpret_cast<const __m128i *>(slotEntries + i * sizeof(uint16_t)));
+        // Entries with the empty flag are negative as int16, and saturate to bytes with the top bit set
+        __m128i flags = _mm_packs_epi16(batch, _mm_setzero_si128());
+        setSelectionBits(selection, i, ~_mm_movemask_epi8(flags) & 0xFF);
+    }
+    selectOccupiedScalar(slotEntries, i, count, selection);
+}
+
+// Compiled for AVX2 on its own, so the rest of the program does not require it
+__attribute__((target("avx2"))) static void selectInRangeAvx2(const uint8_t *values, int count, int32_t low, int32_t high, uint64_t *selection)
+{
+    const __m256i lowVector = _mm256_set1_epi32(low);
+    const __m256i highVector = _mm256_set1_epi32(high);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i batch = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i * sizeof(int32_t)));
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(lowVector, batch), _mm256_cmpgt_epi32(batch, highVector));
+        setSelectionBits(selection, i, ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF);
+    }
+    selectInRangeScalar(values, i, count, low, high, selection);
+}
+
+// Runs during static initialisation, before the CPU model is set up for __builtin_cpu_supports
+static const bool hasAvx2 = []
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}();
+#endif
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ PredicateKernels ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+void PredicateKernels::selectInRange(const uint8_t *values, int count, int32_t low, int32_t high, uint64_t *selection)
+{
+#ifdef PREDICATE_KERNELS_HAVE_X86
+    if (hasAvx2)
+    {
+        selectInRangeAvx2(values, count, low, high, selection);
+    }
+    else
+    {
+        selectInRangeSse2(values, count, low, high, selection);
+    }
+#else
+    selectInRangeScalar(values, 0, count, low, high, selection);
+#endif
+}
+
+void PredicateKernels::selectOccupied(const uint8_t *slotEntries, int count, uint64_t *selection)
+{
+#ifdef PREDICATE_KERNELS_HAVE_X86
+    selectOccupiedSse2(slotEntries, count, selection); // 8 slot entries fill an SSE register already
+#else
+    selectOccupiedScalar(slotEntries, 0, count, selection);
+#endif
+}
+
+const char *PredicateKernels::getImplementationName()
+{
+#ifdef PREDICATE_KERNELS_HAVE_X86
+    return hasAvx2 ? "AVX2" : "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,34 @@
+/**
+ * @file predicate_kernels.h
+ * @brief Defines the PredicateKernels class, vectorised filters over the columns of a page.
+ *
+ * A kernel tests a whole column of a page at once and sets one bit per value in a selection bitmask:
+ * bit i of word i / 64 stands for value i. The caller ANDs the masks of its predicates together and
+ * only then touches the records that are left, so a scan does no per-record work for the records that
+ * do not match.
+ *
+ * On x86-64 the AVX2 kernels are selected at run time on the CPUs that have it, and the SSE2 kernels,
+ * which every x86-64 CPU has, are used otherwise. Elsewhere plain loops are used. All of them produce
+ * the same bitmask. The columns are read with unaligned loads, so they can start anywhere in a page.
+ */
+
+#ifndef PREDICATE_KERNELS_H
+#define PREDICATE_KERNELS_H
+
+#include <cstdint>
+
+class PredicateKernels
+{
+public:
+    // Set bit i of selection for every value i of the int32 column at values with low <= value <= high.
+    // Equality is low == high. Bits are only ever set, so clear selection first
+    static void selectInRange(const uint8_t *values, int count, int32_t low, int32_t high, uint64_t *selection);
+
+    // Set bit i of selection for every uint16 slot entry i whose top bit is clear, i.e. whose slot is occupied
+    static void selectOccupied(const uint8_t *slotEntries, int count, uint64_t *selection);
+
+    // Name of the instruction set in use, e.g. for reporting
+    static const char *getImplementationName();
+};
+
+#endif // PREDICATE_KERNELS_H
@@ -46,3 +46,30 @@ void Record::print() const
 {
     cout << tconst << "\t" << std::fixed << std::setprecision(1) << averageRating << "\t" << numVotes << std::endl;
 }
+
+void Record::serialize(uint8_t *dest) const
+{
+    serializeFields(dest, dest + TCONST_SIZE, dest + TCONST_SIZE + sizeof(float));
+}
+
+Record Record::deserialize(const uint8_t *src)
+{
+    return deserializeFields(src, src + TCONST_SIZE, src + TCONST_SIZE + sizeof(float));
+}
+
+void Record::serializeFields(uint8_t *tconstDest, uint8_t *averageRatingDest, uint8_t *numVotesDest) const
+{
+    std::memcpy(tconstDest, tconst, TCONST_SIZE);
+    std::memcpy(averageRatingDest, &averageRating, sizeof(float));
+    std::memcpy(numVotesDest, &numVotes, sizeof(int));
+}
+
+Record Record::deserializeFields(const uint8_t *tconstSrc, const uint8_t *averageRatingSrc, const uint8_t *numVotesSrc)
+{
+    Record record;
+    std::memcpy(record.tconst, tconstSrc, TCONST_SIZE);
+    record.tconst[TCONST_SIZE] = '\0';
+    std::memcpy(&record.averageRating, averageRatingSrc, sizeof(float));
+    std::memcpy(&record.numVotes, numVotesSrc, sizeof(int));
+    return record;
+}
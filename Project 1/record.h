@@ -17,10 +17,15 @@
 #ifndef RECORD_H
 #define RECORD_H
 #include <string>
+#include <cstdint>
 
 class Record
 {
 public:
+    // Size of a record encoded in a block: 10 tconst characters (the null terminator is not stored), averageRating, numVotes
+    static const int TCONST_SIZE = 10;
+    static const int SERIALIZED_SIZE = TCONST_SIZE + sizeof(float) + sizeof(int);
+
     /**
      * Constructor for the Record class.
      * Initializes a Record object with specified values, enforcing data validation.
@@ -42,7 +47,19 @@ public:
     int getNumVotes() const { return numVotes; }
     void print() const;
 
+    // Encode the record into SERIALIZED_SIZE bytes at dest
+    void serialize(uint8_t *dest) const;
+
+    // Decode a record previously encoded with serialize()
+    static Record deserialize(const uint8_t *src);
+
+    // Encode the fields to three separate places, for layouts that store each attribute in its own column
+    void serializeFields(uint8_t *tconstDest, uint8_t *averageRatingDest, uint8_t *numVotesDest) const;
+    static Record deserializeFields(const uint8_t *tconstSrc, const uint8_t *averageRatingSrc, const uint8_t *numVotesSrc);
+
 private:
+    Record() = default; // Used by deserialize(), the fields are filled in from the encoded bytes
+
     char tconst[11];
     float averageRating;
     int numVotes;
@@ -0,0 +1,133 @@
+#include "replacement_policy.h"
+#include <limits>
+#include <stdexcept>
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ ClockPolicy ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+ClockPolicy::ClockPolicy(int numFrames)
+    : referenceBits(numFrames, false), tracked(numFrames, false), evictable(numFrames, true), clockHand(0), numTracked(0) {}
+
+void ClockPolicy::recordAccess(int frameId)
+{
+    if (!tracked[frameId])
+    {
+        tracked[frameId] = true;
+        numTracked++;
+    }
+    referenceBits[frameId] = true;
+}
+
+void ClockPolicy::remove(int frameId)
+{
+    if (tracked[frameId])
+    {
+        tracked[frameId] = false;
+        referenceBits[frameId] = false;
+        numTracked--;
+    }
+}
+
+void ClockPolicy::setEvictable(int frameId, bool evictable)
+{
+    this->evictable[frameId] = evictable;
+}
+
+int ClockPolicy::evict()
+{
+    if (numTracked == 0)
+    {
+        return -1;
+    }
+
+    // At most two sweeps are needed: the first one clears all reference bits
+    int numFrames = tracked.size();
+    for (int step = 0; step < 2 * numFrames; step++)
+    {
+        int frameId = clockHand;
+        clockHand = (clockHand + 1) % numFrames;
+        if (!tracked[frameId] || !evictable[frameId])
+        {
+            continue;
+        }
+        if (referenceBits[frameId])
+        {
+            // Give the frame a second chance
+            referenceBits[frameId] = false;
+            continue;
+        }
+        remove(frameId);
+        return frameId;
+    }
+    return -1;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ LRUKPolicy ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+LRUKPolicy::LRUKPolicy(int numFrames, int k)
+    : k(k), currentTimestamp(0), histories(numFrames), tracked(numFrames, false), evictable(numFrames, true)
+{
+    if (k < 1)
+    {
+        throw std::invalid_argument("LRU-K requires K >= 1");
+    }
+}
+
+void LRUKPolicy::recordAccess(int frameId)
+{
+    tracked[frameId] = true;
+    std::deque<long long> &history = histories[frameId];
+    history.push_back(currentTimestamp++);
+    if ((int)history.size() > k)
+    {
+        history.pop_front();
+    }
+}
+
+void LRUKPolicy::remove(int frameId)
+{
+    tracked[frameId] = false;
+    histories[frameId].clear();
+}
+
+void LRUKPolicy::setEvictable(int frameId, bool evictable)
+{
+    this->evictable[frameId] = evictable;
+}
+
+int LRUKPolicy::evict()
+{
+    const long long infinity = std::numeric_limits<long long>::max();
+    int victim = -1;
+    long long victimDistance = -1;
+    long long victimOldestAccess = infinity;
+
+    for (int frameId = 0; frameId < (int)tracked.size(); frameId++)
+    {
+        if (!tracked[frameId] || !evictable[frameId])
+        {
+            continue;
+        }
+        const std::deque<long long> &history = histories[frameId];
+
+        // Backward K-distance is infinite if the frame has fewer than K recorded accesses
+        long long distance = (int)history.size() < k ? infinity : currentTimestamp - history.front();
+
+        // Ties (in particular between infinite distances) go to the least recently accessed frame
+        if (distance > victimDistance || (distance == victimDistance && history.front() < victimOldestAccess))
+        {
+            victim = frameId;
+            victimDistance = distance;
+            victimOldestAccess = history.front();
+        }
+    }
+
+    if (victim != -1)
+    {
+        remove(victim);
+    }
+    return victim;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file replacement_policy.h
+ * @brief Defines the page replacement policies used by the BufferPool to pick a victim frame.
+ *
+ * The BufferPool only tells the policy which frames were accessed, which frames were emptied and
+ * which frames are pinned, and asks it for a victim when every frame is in use. Pinned frames are
+ * never chosen as victims. Two policies are provided:
+ *
+ * - ClockPolicy: the classic second-chance algorithm. Every frame has a reference bit that is set on
+ *   access, and a clock hand sweeps over the frames clearing reference bits until it finds a frame
+ *   whose bit is already clear.
+ * - LRUKPolicy: evicts the frame whose K-th most recent access is the furthest in the past (largest
+ *   backward K-distance). Frames with fewer than K accesses have an infinite distance and are evicted
+ *   first, oldest first, which keeps pages touched once by a scan from pushing out frequently used pages.
+ */
+
+#ifndef REPLACEMENT_POLICY_H
+#define REPLACEMENT_POLICY_H
+
+#include <vector>
+#include <deque>
+
+enum class ReplacementPolicyType
+{
+    Clock,
+    LRUK
+};
+
+class ReplacementPolicy
+{
+public:
+    virtual ~ReplacementPolicy() {}
+
+    // Record that the frame was accessed. The first access makes the frame a candidate for eviction
+    virtual void recordAccess(int frameId) = 0;
+
+    // Stop tracking the frame, e.g. after its page has been evicted or deleted
+    virtual void remove(int frameId) = 0;
+
+    // Pinned frames are not evictable until they are unpinned
+    virtual void setEvictable(int frameId, bool evictable) = 0;
+
+    // Choose a frame to evict and stop tracking it. Returns -1 if no frame can be evicted
+    virtual int evict() = 0;
+};
+
+class ClockPolicy : public ReplacementPolicy
+{
+private:
+    std::vector<bool> referenceBits; // Set on access, cleared when the clock hand passes
+    std::vector<bool> tracked;       // Frames currently holding a page
+    std::vector<bool> evictable;     // Frames that are not pinned
+    int clockHand;                   // Next frame to inspect
+    int numTracked;
+
+public:
+    ClockPolicy(int numFrames);
+
+    void recordAccess(int frameId) override;
+    void remove(int frameId) override;
+    void setEvictable(int frameId, bool evictable) override;
+    int evict() override;
+};
+
+class LRUKPolicy : public ReplacementPolicy
+{
+private:
+    int k;
+    long long currentTimestamp;                    // Logical clock, incremented on every access
+    std::vector<std::deque<long long>> histories; // Up to K most recent access timestamps per frame
+    std::vector<bool> tracked;
+    std::vector<bool> evictable;
+
+public:
+    LRUKPolicy(int numFrames, int k);
+
+    void recordAccess(int frameId) override;
+    void remove(int frameId) override;
+    void setEvictable(int frameId, bool evictable) override;
+    int evict() override;
+};
+
+#endif // REPLACEMENT_POLICY_H
@@ -0,0 +1,115 @@
+#include "request_scheduler.h"
+#include <algorithm>
+#include <unordered_set>
+
+RequestScheduler::RequestScheduler(const BlockStorage &storage, SchedulingPolicy policy)
+    : storage(storage), policy(policy) {}
+
+const char *RequestScheduler::getPolicyName() const
+{
+    switch (policy)
+    {
+    case SchedulingPolicy::SCAN:
+        return "SCAN";
+    case SchedulingPolicy::CLOOK:
+        return "C-LOOK";
+    default:
+        return "FIFO";
+    }
+}
+
+/**
+ * @brief Modelled time of issuing the blocks of one device in the given order, starting from the current head position.
+ */
+double RequestScheduler::estimateDeviceTime(int device, const std::vector<int64_t> &blockIds) const
+{
+    double totalTime = 0;
+    int headTrack = storage.getHeadPosition(device);
+    for (int64_t blockId : blockIds)
+    {
+        totalTime += storage.estimateAccessTime(headTrack, blockId);
+        headTrack = storage.blockIdToTrack(blockId);
+    }
+    return totalTime;
+}
+
+/**
+ * @brief Order the requests of one device by the scheduling policy, against the head of that device.
+ */
+std::vector<int64_t> RequestScheduler::orderDeviceRequests(int device, const std::vector<int64_t> &blockIds) const
+{
+    if (policy == SchedulingPolicy::FIFO)
+    {
+        return blockIds;
+    }
+
+    // Split the requests into those at or above the head and those below it, each sorted by track
+    int headTrack = storage.getHeadPosition(device);
+    auto byTrack = [this](int64_t a, int64_t b)
+    {
+        int trackA = storage.blockIdToTrack(a);
+        int trackB = storage.blockIdToTrack(b);
+        return trackA != trackB ? trackA < trackB : a < b;
+    };
+    std::vector<int64_t> above;
+    std::vector<int64_t> below;
+    for (int64_t blockId : blockIds)
+    {
+        (storage.blockIdToTrack(blockId) >= headTrack ? above : below).push_back(blockId);
+    }
+    std::sort(above.begin(), above.end(), byTrack);
+    std::sort(below.begin(), below.end(), byTrack);
+    if (policy == SchedulingPolicy::SCAN)
+    {
+        std::reverse(below.begin(), below.end()); // Sweep back down after the upward sweep
+    }
+
+    above.insert(above.end(), below.begin(), below.end());
+    return above;
+}
+
+ScheduledBatch RequestScheduler::schedule(const std::vector<int64_t> &blockIds) const
+{
+    // Merge duplicate requests, keeping the position of the first one, and split them by device
+    int numDevices = storage.getNumDevices();
+    std::vector<int64_t> requestOrder;
+    std::vector<std::vector<int64_t>> deviceRequests(numDevices);
+    std::unordered_set<int64_t> seenBlockIds;
+    for (int64_t blockId : blockIds)
+    {
+        if (seenBlockIds.insert(blockId).second)
+        {
+            requestOrder.push_back(blockId);
+            deviceRequests[storage.getDeviceOf(blockId)].push_back(blockId);
+        }
+    }
+
+    ScheduledBatch batch;
+    std::vector<std::vector<int64_t>> deviceOrders(numDevices);
+    for (int device = 0; device < numDevices; device++)
+    {
+        deviceOrders[device] = orderDeviceRequests(device, deviceRequests[device]);
+        batch.fifoTime = std::max(batch.fifoTime, estimateDeviceTime(device, deviceRequests[device]));
+        batch.scheduledTime = std::max(batch.scheduledTime, estimateDeviceTime(device, deviceOrders[device]));
+    }
+
+    if (policy == SchedulingPolicy::FIFO)
+    {
+        batch.blockIds = requestOrder;
+        return batch;
+    }
+
+    // Interleave the devices so that every part of the batch keeps all of them busy
+    batch.blockIds.reserve(requestOrder.size());
+    for (int position = 0; batch.blockIds.size() < requestOrder.size(); position++)
+    {
+        for (int device = 0; device < numDevices; device++)
+        {
+            if (position < (int)deviceOrders[device].size())
+            {
+                batch.blockIds.push_back(deviceOrders[device][position]);
+            }
+        }
+    }
+    return batch;
+}
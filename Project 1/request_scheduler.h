@@ -0,0 +1,68 @@
+/**
+ * @file request_scheduler.h
+ * @brief Defines the RequestScheduler class, which orders a batch of block requests to shorten head movement.
+ *
+ * The B+ tree returns record addresses in key order, which jumps back and forth across the disk.
+ * Given a batch of pending block requests, the scheduler orders them by track against the current
+ * head position of the DiskManager, the way a disk controller's elevator would:
+ *
+ * - SCAN sweeps up from the head to the highest requested track, then reverses and sweeps down.
+ *   The sweep turns around at the last request instead of the edge of the disk (the LOOK variant),
+ *   since travelling to the edge serves no request.
+ * - CLOOK sweeps up from the head, then jumps back to the lowest requested track and sweeps up again,
+ *   which gives every track the same waiting time.
+ * - FIFO keeps the order the requests were made in.
+ *
+ * With several devices (see StripedDiskManager), every device has its own head, so the requests of
+ * each device are ordered separately, and the devices are then interleaved request by request so
+ * that a batch keeps all of them busy.
+ *
+ * The modelled time of the batch is estimated both in the scheduled order and in the original order,
+ * so callers can report the time saved by scheduling. Devices work in parallel, so the time of a
+ * batch is that of its busiest device. Estimating does not move any head.
+ */
+
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include "block_storage.h"
+#include <vector>
+
+enum class SchedulingPolicy
+{
+    FIFO,
+    SCAN,
+    CLOOK
+};
+
+/**
+ * A batch of block requests in the order they should be issued.
+ */
+struct ScheduledBatch
+{
+    std::vector<int64_t> blockIds; // Requested blocks in scheduled order, each block once
+    double fifoTime = 0;       // Modelled time of the batch in request order in ms
+    double scheduledTime = 0;  // Modelled time of the batch in scheduled order in ms
+
+    double getTimeSaved() const { return fifoTime - scheduledTime; };
+};
+
+class RequestScheduler
+{
+private:
+    const BlockStorage &storage;
+    SchedulingPolicy policy;
+
+    double estimateDeviceTime(int device, const std::vector<int64_t> &blockIds) const;
+    std::vector<int64_t> orderDeviceRequests(int device, const std::vector<int64_t> &blockIds) const;
+
+public:
+    RequestScheduler(const BlockStorage &storage, SchedulingPolicy policy = SchedulingPolicy::CLOOK);
+
+    // Order the requests, duplicate block IDs are merged into their first request
+    ScheduledBatch schedule(const std::vector<int64_t> &blockIds) const;
+    SchedulingPolicy getPolicy() const { return policy; };
+    const char *getPolicyName() const;
+};
+
+#endif // REQUEST_SCHEDULER_H
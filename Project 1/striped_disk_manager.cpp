@@ -0,0 +1,370 @@
+#include "striped_disk_manager.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+StripedDiskManager::StripedDiskManager(int64_t diskSize, int numDevices, int stripeWidth, StorageMode storageMode,
+                                       const std::string &dataFilePath, bool openExisting)
+    : stripeWidth(stripeWidth), storageMode(storageMode), dataFilePath(dataFilePath), nextBlockId(0), numBlocksUsed(0)
+{
+    if (numDevices < 1 || stripeWidth < 1)
+    {
+        throw std::invalid_argument("Striping needs at least one device and a stripe width of at least one block");
+    }
+    for (int device = 0; device < numDevices; device++)
+    {
+        std::string devicePath = dataFilePath.empty() ? "" : dataFilePath + "." + std::to_string(device);
+        devices.push_back(std::make_unique<DiskManager>(diskSize / numDevices, storageMode, devicePath, openExisting));
+        devices.back()->setDeviceIndex(device);
+    }
+
+    // Rebuild the striped block directory from the blocks found on the devices
+    std::vector<bool> usedBlockIds;
+    for (int device = 0; device < numDevices; device++)
+    {
+        for (int64_t deviceBlockId : devices[device]->getAllBlockIds())
+        {
+            int64_t blockId = toBlockId(device, deviceBlockId);
+            if (blockId >= (int64_t)usedBlockIds.size())
+            {
+                usedBlockIds.resize(blockId + 1, false);
+            }
+            usedBlockIds[blockId] = true;
+            numBlocksUsed++;
+        }
+    }
+    nextBlockId = usedBlockIds.size();
+    for (int64_t blockId = 0; blockId < nextBlockId; blockId++)
+    {
+        if (!usedBlockIds[blockId])
+        {
+            freeBlockIds.push(blockId);
+        }
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Block ID mapping ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+int StripedDiskManager::getDeviceOf(int64_t blockId) const
+{
+    return (blockId / stripeWidth) % devices.size();
+}
+
+// Block ID on its device: the stripe units of one device are stored back to back
+int64_t StripedDiskManager::toDeviceBlockId(int64_t blockId) const
+{
+    int numDevices = devices.size();
+    return blockId / (stripeWidth * numDevices) * stripeWidth + blockId % stripeWidth;
+}
+
+int64_t StripedDiskManager::toBlockId(int device, int64_t deviceBlockId) const
+{
+    int numDevices = devices.size();
+    return deviceBlockId / stripeWidth * stripeWidth * numDevices + device * stripeWidth + deviceBlockId % stripeWidth;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Block access ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+void StripedDiskManager::readBlock(int64_t blockId, Block &block) const
+{
+    if (!hasBlock(blockId))
+    {
+        throw std::runtime_error("Block not found");
+    }
+    deviceOf(blockId).readBlock(toDeviceBlockId(blockId), block);
+}
+
+void StripedDiskManager::readBlocks(const std::vector<int64_t> &blockIds, const std::vector<Block *> &destinations, const std::function<void(int)> &onBlockRead) const
+{
+    // Split the batch by device, remembering the position of every request in the batch
+    int numDevices = devices.size();
+    std::vector<std::vector<int64_t>> deviceBlockIds(numDevices);
+    std::vector<std::vector<Block *>> deviceDestinations(numDevices);
+    std::vector<std::vector<int>> batchPositions(numDevices);
+    for (int i = 0; i < (int)blockIds.size(); i++)
+    {
+        if (!hasBlock(blockIds[i]))
+        {
+            throw std::runtime_error("Block not found");
+        }
+        int device = getDeviceOf(blockIds[i]);
+        deviceBlockIds[device].push_back(toDeviceBlockId(blockIds[i]));
+        deviceDestinations[device].push_back(destinations[i]);
+        batchPositions[device].push_back(i);
+    }
+
+    if (storageMode != StorageMode::File)
+    {
+        // The blocks are already in memory, there is no latency to overlap
+        for (int device = 0; device < numDevices; device++)
+        {
+            devices[device]->readBlocks(deviceBlockIds[device], deviceDestinations[device], [&](int j)
+                                        { onBlockRead(batchPositions[device][j]); });
+        }
+        return;
+    }
+
+    // One thread per device, the completions are handed back to this thread
+    std::mutex mutex;
+    std::condition_variable completionAvailable;
+    std::deque<int> completions;
+    std::vector<std::exception_ptr> deviceErrors(numDevices);
+    int numRunning = 0;
+    std::vector<std::thread> threads;
+    for (int device = 0; device < numDevices; device++)
+    {
+        if (deviceBlockIds[device].empty())
+        {
+            continue;
+        }
+        numRunning++;
+        threads.emplace_back([&, device]
+                             {
+                                 try
+                                 {
+                                     devices[device]->readBlocks(deviceBlockIds[device], deviceDestinations[device], [&](int j)
+                                                                 {
+                                                                     std::lock_guard<std::mutex> lock(mutex);
+                                                                     completions.push_back(batchPositions[device][j]);
+                                                                     completionAvailable.notify_one(); });
+                                 }
+                                 catch (...)
+                                 {
+                                     deviceErrors[device] = std::current_exception();
+                                 }
+                                 std::lock_guard<std::mutex> lock(mutex);
+                                 numRunning--;
+                                 completionAvailable.notify_one(); });
+    }
+
+    std::exception_ptr callbackError;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        completionAvailable.wait(lock, [&]
+                                 { return !completions.empty() || numRunning == 0; });
+        if (completions.empty())
+        {
+            break;
+        }
+        std::deque<int> finished;
+        finished.swap(completions);
+        lock.unlock();
+        for (int position : finished)
+        {
+            if (!callbackError)
+            {
+                try
+                {
+                    onBlockRead(position);
+                }
+                catch (...)
+                {
+                    callbackError = std::current_exception();
+                }
+            }
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    for (std::exception_ptr &deviceError : deviceErrors)
+    {
+        if (deviceError)
+        {
+            std::rethrow_exception(deviceError);
+        }
+    }
+    if (callbackError)
+    {
+        std::rethrow_exception(callbackError);
+    }
+}
+
+void StripedDiskManager::writeBlock(int64_t blockId, const Block &block)
+{
+    if (!hasBlock(blockId))
+    {
+        return;
+    }
+    deviceOf(blockId).writeBlock(toDeviceBlockId(blockId), block);
+}
+
+bool StripedDiskManager::hasBlock(int64_t blockId) const
+{
+    return blockId >= 0 && blockId < nextBlockId && deviceOf(blockId).hasBlock(toDeviceBlockId(blockId));
+}
+
+const Block *StripedDiskManager::getMappedBlock(int64_t blockId) const
+{
+    if (!hasBlock(blockId))
+    {
+        return nullptr;
+    }
+    return deviceOf(blockId).getMappedBlock(toDeviceBlockId(blockId));
+}
+
+void StripedDiskManager::adviseAccessPattern(AccessPattern accessPattern)
+{
+    for (auto &device : devices)
+    {
+        device->adviseAccessPattern(accessPattern);
+    }
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Block allocation ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+int64_t StripedDiskManager::createBlock()
+{
+    if (getNumBlocksUsed() >= getTotalBlockCapacity())
+    {
+        throw std::runtime_error("Disk is full");
+    }
+
+    // Reuse the lowest deleted block ID first so that the used IDs stay dense and evenly spread
+    int64_t blockId;
+    if (!freeBlockIds.empty())
+    {
+        blockId = freeBlockIds.top();
+        freeBlockIds.pop();
+    }
+    else
+    {
+        blockId = nextBlockId++;
+    }
+    deviceOf(blockId).createBlockWithId(toDeviceBlockId(blockId));
+    numBlocksUsed++;
+    return blockId;
+}
+
+void StripedDiskManager::deleteBlock(int64_t blockId)
+{
+    if (!hasBlock(blockId))
+    {
+        throw std::runtime_error("Block not found");
+    }
+    deviceOf(blockId).deleteBlock(toDeviceBlockId(blockId));
+    freeBlockIds.push(blockId);
+    numBlocksUsed--;
+}
+
+int64_t StripedDiskManager::getNumRecordsStored() const
+{
+    int64_t numRecords = 0;
+    for (auto &device : devices)
+    {
+        numRecords += device->getNumRecordsStored();
+    }
+    return numRecords;
+}
+
+int64_t StripedDiskManager::getTotalBlockCapacity() const
+{
+    int64_t totalBlockCapacity = 0;
+    for (auto &device : devices)
+    {
+        totalBlockCapacity += device->getTotalBlockCapacity();
+    }
+    return totalBlockCapacity;
+}
+
+std::vector<int64_t> StripedDiskManager::getAllBlockIds() const
+{
+    std::vector<int64_t> blockIds;
+    blockIds.reserve(numBlocksUsed);
+    for (int64_t blockId = 0; blockId < nextBlockId; blockId++)
+    {
+        if (hasBlock(blockId))
+        {
+            blockIds.push_back(blockId);
+        }
+    }
+    return blockIds;
+}
+
+// The hot chunks are shared out between the devices, every device keeps at least one
+void StripedDiskManager::setMaxHotChunks(int maxHotChunks)
+{
+    int numDevices = devices.size();
+    for (auto &device : devices)
+    {
+        device->setMaxHotChunks(maxHotChunks > 0 ? std::max(1, maxHotChunks / numDevices) : 0);
+    }
+}
+
+TieringStats StripedDiskManager::getTieringStats() const
+{
+    TieringStats tieringStats;
+    for (auto &device : devices)
+    {
+        tieringStats += device->getTieringStats();
+    }
+    return tieringStats;
+}
+
+long long StripedDiskManager::getNumChecksumsVerified() const
+{
+    long long numVerified = 0;
+    for (auto &device : devices)
+    {
+        numVerified += device->getNumChecksumsVerified();
+    }
+    return numVerified;
+}
+
+long long StripedDiskManager::getNumChecksumFailures() const
+{
+    long long numFailures = 0;
+    for (auto &device : devices)
+    {
+        numFailures += device->getNumChecksumFailures();
+    }
+    return numFailures;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Access model ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+double StripedDiskManager::simulateBlockAccessTime(int64_t blockId, IOStats &ioStats)
+{
+    return deviceOf(blockId).simulateBlockAccessTime(toDeviceBlockId(blockId), ioStats);
+}
+
+void StripedDiskManager::seedAccessModel(unsigned seed)
+{
+    // Give every device its own start state, derived from the seed
+    for (int device = 0; device < (int)devices.size(); device++)
+    {
+        devices[device]->seedAccessModel(seed + device);
+    }
+}
+
+int StripedDiskManager::getHeadPosition(int device) const
+{
+    return devices[device]->getHeadPosition(0);
+}
+
+int StripedDiskManager::blockIdToTrack(int64_t blockId) const
+{
+    return deviceOf(blockId).blockIdToTrack(toDeviceBlockId(blockId));
+}
+
+double StripedDiskManager::estimateAccessTime(int headTrack, int64_t blockId) const
+{
+    return deviceOf(blockId).estimateAccessTime(headTrack, toDeviceBlockId(blockId));
+}
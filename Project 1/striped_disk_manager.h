@@ -0,0 +1,86 @@
+/**
+ * @file striped_disk_manager.h
+ * @brief Defines the StripedDiskManager class, which spreads blocks RAID-0 style over several DiskManagers.
+ *
+ * Block IDs are cut into stripe units of stripeWidth consecutive blocks, and the units are dealt out
+ * round-robin over the devices. With 3 devices and a stripe width of 2, blocks 0-1 live on device 0,
+ * blocks 2-3 on device 1, blocks 4-5 on device 2, blocks 6-7 on device 0 again, and so on. Every
+ * device is a DiskManager with its own head and, in the file-backed modes, its own data file
+ * (<dataFilePath>.<device>), so a data set can be larger than a single modelled disk.
+ *
+ * A scan in block ID order keeps every device busy, and batched reads are issued to the devices in
+ * parallel, one thread per device. Since the devices work independently, the elapsed time of a batch
+ * is that of the busiest device (see IOStats::getElapsedTime), which shrinks as devices are added.
+ */
+
+#ifndef STRIPED_DISK_MANAGER_H
+#define STRIPED_DISK_MANAGER_H
+
+#include "block_storage.h"
+#include "disk_manager.h"
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+class StripedDiskManager : public BlockStorage
+{
+private:
+    std::vector<std::unique_ptr<DiskManager>> devices;
+    int stripeWidth; // Consecutive block IDs stored on the same device
+    StorageMode storageMode;
+    std::string dataFilePath; // Base path of the device data files
+
+    std::priority_queue<int64_t, std::vector<int64_t>, std::greater<int64_t>> freeBlockIds; // Deleted block IDs, reused lowest first
+    int64_t nextBlockId;
+    int64_t numBlocksUsed;
+
+    int64_t toDeviceBlockId(int64_t blockId) const;
+    int64_t toBlockId(int device, int64_t deviceBlockId) const;
+    DiskManager &deviceOf(int64_t blockId) const { return *devices[getDeviceOf(blockId)]; };
+
+public:
+    /**
+     * @param diskSize Total size of all devices in bytes, split evenly between them
+     * @param openExisting For File and MemoryMapped modes, keep the blocks already in the device data files
+     */
+    StripedDiskManager(int64_t diskSize, int numDevices, int stripeWidth, StorageMode storageMode = StorageMode::InMemory,
+                       const std::string &dataFilePath = "", bool openExisting = false);
+
+    StripedDiskManager(const StripedDiskManager &) = delete;
+    StripedDiskManager &operator=(const StripedDiskManager &) = delete;
+
+    void readBlock(int64_t blockId, Block &block) const override;
+    void readBlocks(const std::vector<int64_t> &blockIds, const std::vector<Block *> &destinations, const std::function<void(int)> &onBlockRead) const override;
+    void writeBlock(int64_t blockId, const Block &block) override;
+    bool hasBlock(int64_t blockId) const override;
+
+    const Block *getMappedBlock(int64_t blockId) const override;
+    void adviseAccessPattern(AccessPattern accessPattern) override;
+
+    int64_t createBlock() override;
+    void deleteBlock(int64_t blockId) override;
+    int64_t getNumRecordsStored() const override;
+    int64_t getNumBlocksUsed() const override { return numBlocksUsed; };
+    int64_t getTotalBlockCapacity() const override;
+    std::vector<int64_t> getAllBlockIds() const override;
+    StorageMode getStorageMode() const override { return storageMode; };
+    const std::string &getDataFilePath() const override { return dataFilePath; };
+
+    void setMaxHotChunks(int maxHotChunks) override;
+    TieringStats getTieringStats() const override;
+
+    long long getNumChecksumsVerified() const override;
+    long long getNumChecksumFailures() const override;
+
+    double simulateBlockAccessTime(int64_t blockId, IOStats &ioStats) override;
+    void seedAccessModel(unsigned seed) override;
+    int getNumDevices() const override { return devices.size(); };
+    int getDeviceOf(int64_t blockId) const override;
+    int getHeadPosition(int device) const override;
+    int blockIdToTrack(int64_t blockId) const override;
+    double estimateAccessTime(int headTrack, int64_t blockId) const override;
+    int getStripeWidth() const { return stripeWidth; };
+};
+
+#endif // STRIPED_DISK_MANAGER_H
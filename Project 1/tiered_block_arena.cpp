@@ -0,0 +1,133 @@
+#include "tiered_block_arena.h"
+#include "block_codec.h"
+#include <algorithm>
+
+static const size_t CHUNK_SIZE = sizeof(Block) * TieredBlockArena::BLOCKS_PER_CHUNK;
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ TieringStats ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+TieringStats &TieringStats::operator+=(const TieringStats &other)
+{
+    hotChunks += other.hotChunks;
+    coldChunks += other.coldChunks;
+    coldBytes += other.coldBytes;
+    coldCompressedBytes += other.coldCompressedBytes;
+    promotions += other.promotions;
+    demotions += other.demotions;
+    promotedBytes += other.promotedBytes;
+    promotedCompressedBytes += other.promotedCompressedBytes;
+    return *this;
+}
+
+void TieringStats::print(std::ostream &out) const
+{
+    out << "Hot chunks: " << hotChunks << ", cold chunks: " << coldChunks << std::endl;
+    out << "Cold tier: " << coldBytes << " bytes of blocks held in " << coldCompressedBytes
+        << " bytes, memory saved: " << getMemorySaved() << " bytes" << std::endl;
+    out << "Promotions: " << promotions << ", demotions: " << demotions << ", read from cold tier: "
+        << promotedCompressedBytes << " bytes for " << promotedBytes << " bytes of blocks, transfer saved: "
+        << getTransferSaved() << " bytes" << std::endl;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ TieredBlockArena ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+TieredBlockArena::TieredBlockArena() : maxHotChunks(0), clockHand(0) {}
+
+void TieredBlockArena::reserve(int64_t numBlocks)
+{
+    while ((int64_t)chunks.size() * BLOCKS_PER_CHUNK < numBlocks)
+    {
+        chunks.emplace_back();
+        chunks.back().blocks = std::make_unique<Block[]>(BLOCKS_PER_CHUNK);
+        chunks.back().referenced = true;
+        stats.hotChunks++;
+        enforceHotLimit(&chunks.back());
+    }
+}
+
+Block &TieredBlockArena::getBlock(int64_t blockId)
+{
+    Chunk &chunk = chunks[blockId / BLOCKS_PER_CHUNK];
+    if (chunk.blocks == nullptr)
+    {
+        promote(chunk);
+        enforceHotLimit(&chunk);
+    }
+    chunk.referenced = true;
+    return chunk.blocks[blockId % BLOCKS_PER_CHUNK];
+}
+
+void TieredBlockArena::copyChunk(int64_t chunkIndex, Block *destination) const
+{
+    const Chunk &chunk = chunks[chunkIndex];
+    if (chunk.blocks != nullptr)
+    {
+        std::copy(chunk.blocks.get(), chunk.blocks.get() + BLOCKS_PER_CHUNK, destination);
+        return;
+    }
+    BlockCodec::decompress(chunk.compressed, reinterpret_cast<uint8_t *>(destination), CHUNK_SIZE);
+}
+
+void TieredBlockArena::setMaxHotChunks(int maxHotChunks)
+{
+    this->maxHotChunks = maxHotChunks;
+    enforceHotLimit(nullptr);
+}
+
+void TieredBlockArena::promote(Chunk &chunk)
+{
+    chunk.blocks = std::make_unique<Block[]>(BLOCKS_PER_CHUNK);
+    BlockCodec::decompress(chunk.compressed, reinterpret_cast<uint8_t *>(chunk.blocks.get()), CHUNK_SIZE);
+    stats.promotions++;
+    stats.promotedBytes += CHUNK_SIZE;
+    stats.promotedCompressedBytes += chunk.compressed.size();
+    stats.coldChunks--;
+    stats.coldBytes -= CHUNK_SIZE;
+    stats.coldCompressedBytes -= chunk.compressed.size();
+    stats.hotChunks++;
+    chunk.compressed = std::vector<uint8_t>(); // Release the capacity as well
+}
+
+void TieredBlockArena::demote(Chunk &chunk)
+{
+    chunk.compressed = BlockCodec::compress(reinterpret_cast<const uint8_t *>(chunk.blocks.get()), CHUNK_SIZE);
+    chunk.compressed.shrink_to_fit();
+    chunk.blocks.reset();
+    chunk.referenced = false;
+    stats.demotions++;
+    stats.hotChunks--;
+    stats.coldChunks++;
+    stats.coldBytes += CHUNK_SIZE;
+    stats.coldCompressedBytes += chunk.compressed.size();
+}
+
+/**
+ * @brief Compress hot chunks until at most maxHotChunks are left. Chunks touched since the last sweep
+ * get a second chance, and keep, the chunk being accessed, is never compressed.
+ */
+void TieredBlockArena::enforceHotLimit(const Chunk *keep)
+{
+    if (maxHotChunks <= 0)
+    {
+        return;
+    }
+    while (stats.hotChunks > maxHotChunks)
+    {
+        Chunk &chunk = chunks[clockHand];
+        clockHand = (clockHand + 1) % chunks.size();
+        if (chunk.blocks == nullptr || &chunk == keep)
+        {
+            continue;
+        }
+        if (chunk.referenced)
+        {
+            chunk.referenced = false;
+            continue;
+        }
+        demote(chunk);
+    }
+}
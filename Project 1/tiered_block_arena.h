@@ -0,0 +1,84 @@
+/**
+ * @file tiered_block_arena.h
+ * @brief Defines the TieredBlockArena class, the in-memory block store of DiskManager, with a hot and a cold tier.
+ *
+ * Blocks are kept in chunks of BLOCKS_PER_CHUNK consecutive block IDs. A hot chunk is a plain array of
+ * blocks. Once more than maxHotChunks chunks are hot, a clock sweep picks one that was not touched
+ * recently, compresses it with BlockCodec and frees its array. Touching a block of a cold chunk
+ * decompresses the whole chunk back into the hot tier.
+ *
+ * IMDb-style rows are rarely touched after they are loaded, so most chunks stay cold and the arena
+ * shrinks towards its compressed size. TieringStats reports the memory this saves, and the bytes saved
+ * when cold chunks are brought back, as if the cold tier were on slower storage.
+ * With maxHotChunks = 0 tiering is off and every chunk stays hot.
+ */
+
+#ifndef TIERED_BLOCK_ARENA_H
+#define TIERED_BLOCK_ARENA_H
+
+#include "block.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+struct TieringStats
+{
+    long long hotChunks = 0;
+    long long coldChunks = 0;
+    long long coldBytes = 0;               // Uncompressed size of the cold chunks
+    long long coldCompressedBytes = 0;     // Memory actually held by the cold chunks
+    long long promotions = 0;              // Cold chunks decompressed because one of their blocks was accessed
+    long long demotions = 0;               // Hot chunks compressed into the cold tier
+    long long promotedBytes = 0;           // Uncompressed size of the promoted chunks
+    long long promotedCompressedBytes = 0; // Bytes the promotions read from the cold tier
+
+    long long getMemorySaved() const { return coldBytes - coldCompressedBytes; };
+    long long getTransferSaved() const { return promotedBytes - promotedCompressedBytes; };
+
+    TieringStats &operator+=(const TieringStats &other);
+    void print(std::ostream &out) const;
+};
+
+class TieredBlockArena
+{
+private:
+    struct Chunk
+    {
+        std::unique_ptr<Block[]> blocks; // Uncompressed blocks, nullptr while the chunk is cold
+        std::vector<uint8_t> compressed; // Compressed blocks while the chunk is cold
+        bool referenced = false;         // Reference bit of the clock sweep
+    };
+
+    std::vector<Chunk> chunks;
+    int maxHotChunks; // 0 keeps every chunk hot
+    size_t clockHand;
+    TieringStats stats;
+
+    void promote(Chunk &chunk);
+    void demote(Chunk &chunk);
+    void enforceHotLimit(const Chunk *keep);
+
+public:
+    static constexpr int BLOCKS_PER_CHUNK = 1024;
+
+    TieredBlockArena();
+
+    TieredBlockArena(const TieredBlockArena &) = delete;
+    TieredBlockArena &operator=(const TieredBlockArena &) = delete;
+
+    // Add chunks of empty blocks until block IDs below numBlocks can be stored
+    void reserve(int64_t numBlocks);
+
+    // The block, promoting its chunk if it is cold. The reference is only valid until the next call
+    Block &getBlock(int64_t blockId);
+
+    // Copy every block of a chunk to destination, without promoting the chunk
+    void copyChunk(int64_t chunkIndex, Block *destination) const;
+    int64_t getNumChunks() const { return chunks.size(); };
+
+    void setMaxHotChunks(int maxHotChunks);
+    const TieringStats &getStats() const { return stats; };
+};
+
+#endif // TIERED_BLOCK_ARENA_H
@@ -1,38 +1,25 @@
 #include "tree_helper.h"
 
 /*
-~~~~~~~~~~~~~~~~~~~~~~~ KeyPointerPair ~~~~~~~~~~~~~~~~~~~~~~~~
+~~~~~~~~~~~~~~~~~~~~~~~ RecordPointer ~~~~~~~~~~~~~~~~~~~~~~~~
 */
 
-// Default constructor
-KeyPointerPair::KeyPointerPair() : key(nullInt), blockId(nullInt), blockOffset(nullInt) {}
+// Pointer to no record
+RecordPointer::RecordPointer() : blockId(-1), blockOffset(-1) {}
 
 // Constructor initializing all attributes
-KeyPointerPair::KeyPointerPair(int key, int blockId, int blockOffset) : key(key), blockId(blockId), blockOffset(blockOffset) {}
+RecordPointer::RecordPointer(int64_t blockId, int blockOffset) : blockId(blockId), blockOffset(blockOffset) {}
 
-/*
-~~~~~~~~~~~~~~~~~~~~~~~ LeafNode ~~~~~~~~~~~~~~~~~~~~~~~~
-*/
-
-// Default constructor
-LeafNode::LeafNode() {
-    for (int i = 0; i < n; i++) {
-        kppArray[i] = KeyPointerPair();
-    }
-
-    nextNode = nullptr;
+bool RecordPointer::operator==(const RecordPointer& other) const {
+    return blockId == other.blockId && blockOffset == other.blockOffset;
 }
 
-/*
-~~~~~~~~~~~~~~~~~~~~~~~ NonLeafNode ~~~~~~~~~~~~~~~~~~~~~~~~
-*/
+// Order of the records on disk: by block, then by slot
+bool RecordPointer::operator<(const RecordPointer& other) const {
+    return blockId < other.blockId || (blockId == other.blockId && blockOffset < other.blockOffset);
+}
 
-// Default constructor
-NonLeafNode::NonLeafNode() {
-    for (int i = 0; i < n; i++) {
-        keyArray[i] = nullInt;
-    }
-    for (int i = 0; i < n + 1; i++) {
-        ptrArray[i] = nullptr;
-    }
-}
\ No newline at end of file
+// Record address as one integer: a slot number fits in 16 bits
+size_t std::hash<RecordPointer>::operator()(const RecordPointer& pointer) const {
+    return std::hash<uint64_t>()((uint64_t)pointer.blockId << 16 | (uint16_t)pointer.blockOffset);
+}
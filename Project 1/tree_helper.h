@@ -1,60 +1,128 @@
 #pragma once // Header guard to prevent multiple inclusions
 #include <string>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 using namespace std;
 
-// Maximum number of keys that a LeafNode or NonLeafNode can hold
-const int n = 16;
+// Size of a cache line and of a memory page, the sizes that the fanouts of a B+ tree are derived from
+const size_t CACHE_LINE_SIZE = 64;
+const size_t MEMORY_PAGE_SIZE = 4096;
 
-// Integer value to indicate the key is empty
-const double nullInt = -1;
+// Key stored in the places of a node that are not in use. Searches only look at the numKeys keys in use
+template <typename Key>
+constexpr Key getEmptyKey() {
+    return static_cast<Key>(-1);
+}
+
+#pragma pack(push, 4)
+/**
+ * Pointer to a record: the block it is stored in and its slot in the block.
+ * The payload of the B+ tree that indexes the records.
+ *
+ * Packed to 4-byte alignment, so that a KeyPointerPair of a 4-byte key and
+ * a RecordPointer takes 16 bytes instead of 24. Read the fields by value:
+ * blockId is not 8-byte aligned, so it cannot be bound to an int64_t&.
+*/
+struct RecordPointer {
+    int64_t blockId;
+    int blockOffset;
+
+    // Pointer to no record
+    RecordPointer();
+
+    RecordPointer(int64_t blockId, int blockOffset);
+
+    bool operator==(const RecordPointer& other) const;
+    bool operator<(const RecordPointer& other) const;
+};
+#pragma pack(pop)
+
+// Hash of a RecordPointer, so that records can be looked up by their pointer
+namespace std {
+    template <>
+    struct hash<RecordPointer> {
+        size_t operator()(const RecordPointer& pointer) const;
+    };
+}
 
 /**
  * Stores a reference to one pair of record key and pointer to
- * the record in the leaf node. 
- * 
- * An instance of this class is designed to be unique, because 
+ * the record in the leaf node.
+ *
+ * An instance of this class is designed to be unique, because
  * value of keys can be repeated. Therefore, do not use this in non-leaf nodes
- * 
+ *
  * A visualization of an instance of this class will look like this:
  * KeyPointerPair [ pointer_to_record | key ]
+ *
+ * @tparam Key Type of the keys, compared with < and ==
+ * @tparam Value Type of the pointer to the record, e.g. RecordPointer
 */
+template <typename Key, typename Value>
 class KeyPointerPair {
     public:
-        // Key of the record
-        int key;
-
         // Reference to the data record
-        int blockId;
-        int blockOffset;
+        Value pointer;
 
-        // Default constructor
-        KeyPointerPair();
+        // Key of the record
+        Key key;
+
+        // Default constructor, an empty pair
+        KeyPointerPair() : pointer(), key(getEmptyKey<Key>()) {}
 
         // Constructor initializing all attributes
-        KeyPointerPair(int key, int blockId, int blockOffset);
+        KeyPointerPair(Key key, const Value& pointer) : pointer(pointer), key(key) {}
+};
+
+// Kind of a Node, stored in its header
+enum class NodeType : uint8_t {
+    Leaf,
+    NonLeaf
 };
 
 /**
- * Virtual base class for LeafNode and NonLeafNode
- * 
- * For node traversal purposes
+ * Base class for LeafNode and NonLeafNode
+ *
+ * For node traversal purposes. Every node starts with a compact header
+ * that tells what kind of node it is, so traversals check the type and
+ * static_cast instead of relying on RTTI and dynamic_cast.
+ * The header is the same for every key type and fanout.
+ *
+ * A visualization of the header will look like this:
+ * Node header [ type | level | numKeys ]
 */
 class Node {
     public:
-        virtual ~Node() {}
+        // Whether this is a LeafNode or a NonLeafNode
+        NodeType type;
+
+        // Height above the LeafNodes: 0 for a LeafNode, one more than its children for a NonLeafNode
+        uint8_t level;
+
+        // Number of keys in use, stored at the start of the key array
+        uint16_t numKeys;
+
+        bool isLeaf() const { return type == NodeType::Leaf; }
+
+    protected:
+        Node(NodeType type, int level) : type(type), level(level), numKeys(0) {}
 };
 
 /**
  * Stores a reference to one leaf node within a B+ tree
- * 
+ *
  * A visualization of an instance of this class will look like this:
  * (kpp is an instance of KeyPointerPair)
  * Leaf Node [ kpp_0 | kpp_1 | ... | kpp_n | pointer_to_next_node]
+ *
+ * @tparam Fanout Maximum number of keys that the node can hold
 */
+template <typename Key, typename Value, int Fanout>
 class LeafNode : public Node {
-    public: 
+    public:
         // Stores an array of KeyPointerPair classes
-        KeyPointerPair kppArray[n]; 
+        KeyPointerPair<Key, Value> kppArray[Fanout];
 
         // Reference to the next LeafNode in the linked list
         LeafNode* nextNode;
@@ -65,18 +133,72 @@ class LeafNode : public Node {
 
 /**
  * Stores a reference to one non-leaf node or internal node within a B+ tree
- * 
+ *
  * A visualization of an instance of this class will look like this:
  * Non-Leaf Node [ ptr_0 | key_0 | ptr_1 | key_1 | ... | ptr_n | key_n | ptr_n+1 ]
+ *
+ * @tparam Fanout Maximum number of keys that the node can hold
 */
-class NonLeafNode : public Node{
+template <typename Key, int Fanout>
+class NonLeafNode : public Node {
     public:
         // Stores an array of pointers to LeafNodes or NonLeafNodes
-        Node* ptrArray[n + 1];
+        Node* ptrArray[Fanout + 1];
 
         // Stores an array of keys
-        int keyArray[n];
+        Key keyArray[Fanout];
 
-        // Default constructor
-        NonLeafNode();
+        // Constructor of a node at the given level, 1 for the parents of LeafNodes
+        NonLeafNode(int level);
 };
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ Fanouts ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+/**
+ * Fanout whose keys fill exactly one cache line, so the search within a
+ * NonLeafNode reads a single cache line of keys. 16 for int keys.
+*/
+template <typename Key>
+constexpr int getCacheLineFanout() {
+    return CACHE_LINE_SIZE / sizeof(Key);
+}
+
+/**
+ * Largest fanout whose LeafNode fits in one memory page, so the nodes have
+ * the shape of a disk-based B+ tree. 255 for int keys and RecordPointers.
+*/
+template <typename Key, typename Value>
+constexpr int getPageFanout() {
+    return (MEMORY_PAGE_SIZE - sizeof(LeafNode<Key, Value, 1>)) / sizeof(KeyPointerPair<Key, Value>) + 1;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ LeafNode ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+// Default constructor
+template <typename Key, typename Value, int Fanout>
+LeafNode<Key, Value, Fanout>::LeafNode() : Node(NodeType::Leaf, 0) {
+    for (int i = 0; i < Fanout; i++) {
+        kppArray[i] = KeyPointerPair<Key, Value>();
+    }
+
+    nextNode = nullptr;
+}
+
+/*
+~~~~~~~~~~~~~~~~~~~~~~~ NonLeafNode ~~~~~~~~~~~~~~~~~~~~~~~~
+*/
+
+// Constructor of a node at the given level, 1 for the parents of LeafNodes
+template <typename Key, int Fanout>
+NonLeafNode<Key, Fanout>::NonLeafNode(int level) : Node(NodeType::NonLeaf, level) {
+    for (int i = 0; i < Fanout; i++) {
+        keyArray[i] = getEmptyKey<Key>();
+    }
+    for (int i = 0; i < Fanout + 1; i++) {
+        ptrArray[i] = nullptr;
+    }
+}